@@ -29,7 +29,14 @@ public:
     /** Defines the driving policy of the state.
      *
      * @param cs the driver's perception of the environment. */
-    virtual CarControl drive(CarState &cs);
+    virtual CarControl drive(const CarState &cs);
+
+    /** Cheap action to send if the next drive is late (it must not read any
+     * sensor). By default the last action is repeated.
+     *
+     * @param last the last action computed in this state.
+     * @return the fallback action. */
+    virtual CarControl fallback(const CarControl &last) const;
 
     /** Called when entering the state. */
     virtual void enter();
@@ -37,6 +44,9 @@ public:
     /** Called when exiting the state. */
     virtual void exit();
 
+    /** Name of the state, used in reports. */
+    virtual const char *name() const;
+
 
 
 /**************************************************************************
@@ -49,31 +59,31 @@ protected:
     * 
     * @param cs A CarState data structure that describes the car's perception of the environment by it's sensors information.
     * @return The steering angle value output [-1, 1] full right and full left respectively.*/
-    virtual float get_steer(CarState &cs) = 0;
+    virtual float get_steer(const CarState &cs) = 0;
 
     /** Determines the gear value according to the car's perception of the environment.
     *
     * @param cs A CarState data structure that describes the car's perception of the environment by it's sensors information.
     * @return The gear value [-1, 0, 1, ..., 6], which -1 is reverse and 0 is neutral.*/
-    virtual int get_gear(CarState &cs) = 0;
+    virtual int get_gear(const CarState &cs) = 0;
 
     /** Defines the intensity of the virtual gas pedal  according to the car's perception of the environment.
      *
      * @param cs A CarState data structure that describes the car's perception of the environment by it's sensors information.
      * @return The acceleration intensity [0, 1], 0 means no gas, 1 full gas. */
-    virtual float get_accel(CarState &cs) = 0;
+    virtual float get_accel(const CarState &cs) = 0;
 
     /** Defines the intensity of the virtual break pedal  according to the car's perception of the environment.
      *
      * @param cs A CarState data structure that describes the car's perception of the environment by it's sensors information.
      * @return The break intensity [0, 1], 0 means no break, 1 full break. */
-    virtual float get_brake(CarState &cs) = 0;
+    virtual float get_brake(const CarState &cs) = 0;
 
     /** Defines the intensity of the virtual clutch pedal  according to the car's perception of the environment.
      *
      * @param cs A CarState data structure that describes the car's perception of the environment by it's sensors information.
      * @return The clutch intensity [0, 1], 0 means no clutch, 1 full clutch. */
-    virtual float get_clutch(CarState &cs) = 0;
+    virtual float get_clutch(const CarState &cs) = 0;
 
 };
 
@@ -11,13 +11,22 @@
 #ifndef UNB_FSMDRIVER_FSM_H
 #define UNB_FSMDRIVER_FSM_H
 
-#define UNKN   0
-#define ROAD   1
-#define DIRT   2
+#include <vector>
 
 #include "DrivingState.h"
+#include "FSMTrace.h"
+#include "KnowledgeFile.h"
+#include "Landmarks.h"
+#include "SpeedGrid.h"
+#include "TrackProfile.h"
 #include "WrapperBaseDriver.h"
 
+#ifdef __CARSTATE_ACCESS_STATS__
+#include <map>
+#include <string>
+#include <vector>
+#endif
+
 /** A Finite State Machine controller for TORCS. */
 class FSMDriver : public WrapperBaseDriver {
 public:
@@ -35,33 +44,121 @@ public:
 	/** Changes the FSM's current state to its previous state. */
 	void revertState();
 
+	/**
+	 * @brief init angles of range finders.
+	 * @details In order to maximize the efficiency of the information received from
+	 * the track, the vector of sensors in the Three-State FSM was initialized
+	 * according to a normal distribution, i.e., the sensors are more
+	 * densely distributed in front of car and less on the sides. Also
+	 * sets the surface found in the warmup and reads the landmarks learnt
+	 * on the track.
+	 *
+	 * @param angles values in degrees of the range finders.
+	 */
+	virtual void init(float *angles);
+	/** Called when the driver finishes the race: saves the landmarks. */
+	virtual void onShutdown();
+	/** Called when TORCS asks a race restart. */
+	virtual void onRestart();
+
 	/** Analyses the given perception and transitions between states accordingly.
      *
 	 * @param cs the driver's perception of the environment. */
-    virtual void transition(CarState &cs) = 0;
+    virtual void transition(const CarState &cs) = 0;
 
 	/** Defines the controllers actions based on its perception.
 	 *
 	 * @param cs the driver's perception of the environment.
 	 * @return the actions to take. */
-    CarControl wDrive(CarState cs);
+    CarControl wDrive(const CarState &cs);
+
+	/** Action to send if the next tick is late: the current state's fallback.
+	 *
+	 * @param last the last action computed.
+	 * @return the fallback action. */
+    CarControl fallbackControl(const CarControl &last);
 
 	/** Pointer to the FSM's current state. */
 	DrivingState *current_state;
 	/** Pointer to the state the FSM was previously in. */
 	DrivingState *previous_state;
 
+	/** The current state's drive, fallback and name. A driver that keeps its
+	 * states elsewhere than in current_state (see StaticFSM.h) overrides
+	 * them. */
+	virtual CarControl stateDrive(const CarState &cs);
+	virtual CarControl stateFallback(const CarControl &last) const;
+	virtual const char *stateName() const;
+
 	/** Indicates wich state of the test track was, unknown or road or dirt. */
 	int tested;
 	/** Indicates wich track the drive is, road or dirt. */
 	std::string road_or_dirt;
+	/** Surface of the track, resolved once and kept for the later stages. */
+	TrackProfile profile;
+	/** Whether the parameters of the surface found in the warmup are set. */
+	bool surface_set;
+
+	/** The last ticks: states, transitions and actions. */
+	FSMTrace trace;
+
+	/** Writes the trace to a file.
+	 *
+	 * @param path the file.
+	 * @return false if it cannot be written. */
+	virtual bool dumpTrace(const char *path);
+
+	/** The knowledge file read at init: memory uses its landmarks, so it
+	 * is declared before, so destroyed after, memory. */
+	KnowledgeFile knowledge_file;
+	/** Landmarks of the online learning: where the car left the track, and
+	 * how fast it should go there. */
+	Landmarks memory;
+	/** Speed caps the landmarks put on the track ahead, for the states. */
+	SpeedGrid speed_caps;
+
+	/** Learns a landmark: adds it to memory and its cap to speed_caps. */
+	void addLandmark(const Knowledge &k);
+
+	/** Reads the landmarks learnt on the track (<track>.bin) into memory and
+	 * speed_caps; a missing or corrupted file leaves them empty. */
+	void loadKnowledge();
+	/** Writes memory to <track>.bin, unless the track is unknown. */
+	void saveKnowledge();
+
+	/** Sets the states' parameters for road tracks (nothing by default). */
+	virtual void setROAD();
+	/** Sets the states' parameters for dirt tracks (nothing by default). */
+	virtual void setDIRT();
+	/** Calls setROAD or setDIRT for a surface; UNKN leaves the parameters.
+	 *
+	 * @param surface UNKN, ROAD or DIRT. */
+	void setSurface(int surface);
+	/** Applies the surface found by the warmup test once, saving it to the
+	 * profile, and the profile again when it is edited (in the later stages).
+	 * The drivers call it at the start of their transition. */
+	void updateSurface();
 // protected:
 private:
 	/** Distance covered in braking. */
 	float dist;
 	/** Threshold value for decide if the track is road or dirt. */
 	float threshold;
-	CarControl testTrack(CarState cs);
+	/** Whether testTrack reached its speed and is braking. */
+	bool test_braking;
+	CarControl testTrack(const CarState &cs);
+
+#ifdef __CARSTATE_ACCESS_STATS__
+	/** Sensor reads per CarState field, made by the transition and by each
+	 * state's drive, printed when the driver is destroyed. */
+	std::map<std::string, std::vector<unsigned long> > sensor_reads;
+
+	/** Adds the reads made on cs so far to those of who, and clears them. */
+	void countReads(const char *who, const CarState &cs);
+
+	/** Prints sensor_reads, one line per field and one column per reader. */
+	void printReads();
+#endif
 };
 
 #endif // UNB_FSMDRIVER_FSM_H
@@ -0,0 +1,119 @@
+/**  @file: FSMTrace.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#ifndef UNB_FSMDRIVER_FSM_TRACE_H
+#define UNB_FSMDRIVER_FSM_TRACE_H
+
+#include <string>
+#include <vector>
+
+#include "CarControl.h"
+
+/** The last CAPACITY ticks of a FSM driver: where the car was, the state
+ * before and after the transition, what made the transition, and the
+ * actuators chosen.
+ *
+ * The records are kept in a ring written by the driver's thread only, and
+ * recording one is a few stores, so the trace is always on. dump() writes
+ * it to a file (the client does on SIGUSR1 and at the end with
+ * trace:<file>), which bin/fsmtrace decodes.
+ *
+ * The file starts with MAGIC, then (little-endian numbers):
+ *     - the number of states, 1 byte, and each state's name, '\0' ended
+ *     - the number of records, 4 bytes, and the records, oldest first,
+ *       RECORD_LEN bytes each in the order of trecord's fields */
+class FSMTrace {
+public:
+    /** Records kept (a power of two). */
+    static const unsigned int CAPACITY = 4096;
+    /** A state or cause that is not known. */
+    static const unsigned char NONE = 0xff;
+    static const char MAGIC[8];
+    static const size_t RECORD_LEN = 40;
+
+    typedef struct {
+        /** When the tick was driven, in ns (LatencyStats::now()). */
+        long long time;
+        /** Ticks driven before this one. */
+        unsigned int tick;
+        float distFromStart;
+        /** States before and after the transition (positions in the names). */
+        unsigned char from, to;
+        /** Guards that held and rule taken, for drivers with a
+         * TransitionTable, else NONE. */
+        unsigned char guards, rule;
+        float accel, brake, steer, clutch;
+        int gear;
+    } trecord;
+
+    FSMTrace();
+
+    /** Notes the guards that held and the rule taken by this tick's
+     * transition; the next record holds them. */
+    void cause(unsigned int guards, unsigned int rule) {
+        pendingGuards = (unsigned char) guards;
+        pendingRule = (unsigned char) rule;
+    }
+
+    /** Records a tick.
+     *
+     * @param time when the tick was driven.
+     * @param from, to names of the states before and after the transition.
+     * @param distFromStart where the car was.
+     * @param cc the actuators chosen. */
+    void record(long long time, const char *from, const char *to, float distFromStart, const CarControl &cc) {
+        trecord &r = records[ticks & (CAPACITY-1)];
+        r.time = time;
+        r.tick = ticks++;
+        r.distFromStart = distFromStart;
+        r.from = stateId(from);
+        r.to = stateId(to);
+        r.guards = pendingGuards;
+        r.rule = pendingRule;
+        pendingGuards = pendingRule = NONE;
+        r.accel = cc.getAccel();
+        r.brake = cc.getBrake();
+        r.steer = cc.getSteer();
+        r.clutch = cc.getClutch();
+        r.gear = cc.getGear();
+    }
+
+    /** Writes the records kept to a file.
+     *
+     * @return false if it cannot be written. */
+    bool dump(const char *path) const;
+
+    /** Reads a file written by dump.
+     *
+     * @return false if it cannot be read or is not a trace. */
+    static bool load(const char *path, std::vector<std::string> &states, std::vector<trecord> &records);
+
+private:
+    static const unsigned int STATES_MAX = 16;
+
+    std::vector<trecord> records;
+    unsigned int ticks;
+    unsigned char pendingGuards, pendingRule;
+
+    /** Names of the states seen so far; they are compared by address, as
+     * every state returns the same literal. */
+    const char *states[STATES_MAX];
+    unsigned int statesNum;
+
+    unsigned char stateId(const char *name) {
+        for (unsigned int i = 0; i < statesNum; ++i)
+            if (states[i] == name) return (unsigned char) i;
+        if (name == nullptr || statesNum == STATES_MAX) return NONE;
+        states[statesNum] = name;
+        return (unsigned char) statesNum++;
+    }
+};
+
+#endif // UNB_FSMDRIVER_FSM_TRACE_H
@@ -11,8 +11,10 @@
 #ifndef UNB_FSMDRIVER_STATE_INSIDE_TRACK_H
 #define UNB_FSMDRIVER_STATE_INSIDE_TRACK_H
 
+#include <algorithm>
 #include <cmath>
 #include "DrivingState.h"
+#include "SpeedGrid.h"
 
 /**
  * @brief InsideTrack state
@@ -54,8 +56,11 @@ public:
     @param cs the driver's perception of the environment. 
     @return A CarControl with correct values for the actuators.
     */
-    CarControl drive(CarState &);
+    CarControl drive(const CarState &);
     
+    /** Name of the state, used in reports. */
+    const char *name() const;
+
     /**************************************************************************
     * Modularization*/
 
@@ -63,32 +68,37 @@ public:
     *calculated using angle value from cs, case not using the distance (highest track sensor value).
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     *@return A normalized steer value.*/
-    virtual float get_steer(CarState &cs);
+    virtual float get_steer(const CarState &cs);
 
     /** It receives the gear from cs, based on it and rpm it decreases or increases the gear.
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return The gear value accordingthe car's rpm.*/
-    virtual int get_gear(CarState &cs);
+    virtual int get_gear(const CarState &cs);
 
     /** It sets the target_speed based on cs, and decides if should applies full gas or no gas.
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     *@return 0 if the current speed is higher than the target_speed and 1 if it is lower than the target_speed.*/
-    virtual float get_accel(CarState &cs);
+    virtual float get_accel(const CarState &cs);
 
     /** It sets the target_speed based on cs, and decides if should applies 0.3 break intesity or no break.
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     *@return 0.3 if the current speed is higher than the target_speed and 0 if it is lower than the target_speed.*/
-    virtual float get_brake(CarState &cs);
+    virtual float get_brake(const CarState &cs);
 
     /** It recives the cs and calculates the clutch, always returning 0.
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     *@return Always 0. */
-    virtual float get_clutch(CarState &cs);
+    virtual float get_clutch(const CarState &cs);
 
     /**************************************************************************/
 
     /** Auxiliar funcion to set class attributes*/
     void setParameters(int, int, int, int, int, float, float);
+
+    /** Caps the target speed with the landmarks ahead of the car.
+    * @param caps the caps of the driver's landmarks, or NULL for none (the default).*/
+    void setSpeedCaps(const SpeedGrid *caps) { speed_caps = caps; }
+
     //! Empty destructor
     ~InsideTrack();
 
@@ -123,6 +133,9 @@ private:
     /** The speed the car must reach, it is calculated based on distance, base_speed and speed_factor.*/
     float target_speed;
 
+    /** Speed caps of the landmarks of the online learning, or NULL.*/
+    const SpeedGrid *speed_caps;
+
     /** Checks the current_gear and rpm, if the gear and rpm is above a certain value the function authorizes to decrease gear.
     * @param current_gear the gear of the car at the moment of execution.
     * @param rpm the value of the engine rotation read by the sensor.
@@ -160,19 +173,20 @@ private:
     * @return True if the driver must increase gear and false if it must not.*/
     bool shouldIncreaseGear(int current_gear, int rpm);
 
-    /** Changes the target_speed based on base_speed, speed_factor and distance.
+    /** Changes the target_speed based on base_speed, speed_factor and distance, and
+    * the speed caps of the track ahead.
     * @param cs a data structure cointaining information from the car's sensors.*/
-    void setTargetSpeed(CarState &cs);
+    void setTargetSpeed(const CarState &cs);
 
     /** Verifies if the car is driving the right path, once it is possible.
     * that the car collide and turn to the opposite way.
     * @param cs a data structure cointaining information from the car's sensors.*/
-    bool isFacingWrongWay(CarState &cs);
+    bool isFacingWrongWay(const CarState &cs);
 
     /** Find the highest value of the 19 track sensors.
     * @param cs a data structure cointaining information from the car's sensors.
     * @return the index of the track sensor with highest value.*/
-    float findFarthestDirection(CarState &cs);
+    float findFarthestDirection(const CarState &cs);
 
     /** It receive angle at radians (0.785398, -0.785398) and normalize it to -1 and 1.
     * @param angle a data from the car's sensor angle.
@@ -181,4 +195,125 @@ private:
 
 };
 
+/* The per-tick methods are defined here so that a driver which knows the
+ * state type (see StaticFSM.h) can inline them. */
+inline bool
+InsideTrack::shouldDecreaseGear(int current_gear, int rpm) {
+    if(isLowGear(current_gear) && runningOnLow(rpm)) return true;
+    if(isHighGear(current_gear) && runningUnderAverage(rpm)) return true;
+    return false;
+}
+
+inline bool
+InsideTrack::runningOnLow(int rpm) {
+    return (rpm < low_rpm);
+}
+
+inline bool
+InsideTrack::runningUnderAverage(int rpm) {
+    return (rpm <= average_rpm);
+}
+
+inline bool
+InsideTrack::runningOnHigh(int rpm) {
+    return (rpm > high_rpm);
+}
+
+inline bool
+InsideTrack::isLowGear(int gear) {
+    return (gear > start_gear && gear < low_gear_limit);
+}
+
+inline bool
+InsideTrack::isHighGear(int gear) {
+    return (gear >= low_gear_limit);
+}
+
+inline bool
+InsideTrack::shouldIncreaseGear(int current_gear, int rpm) {
+    return runningOnHigh(rpm);
+}
+
+inline bool
+InsideTrack::isFacingWrongWay(const CarState &cs) {
+    return cs.getAngle() < -M_PI/2 || cs.getAngle() > M_PI/2;
+}
+
+inline void
+InsideTrack::setTargetSpeed(const CarState &cs) {
+    this->target_speed = base_speed + speed_factor*this->distance;
+    if (speed_caps != NULL)
+        this->target_speed = std::min(this->target_speed, speed_caps->cap(cs.getDistFromStart()));
+}
+
+inline float
+InsideTrack::findFarthestDirection(const CarState &cs) {
+    float farthestSensor = -INFINITY;
+    float farthestDirection = 0;
+       for (int i = 0; i < 19; i++) { /*Percorre os sensores de pista e guarda o de maior valor*/
+          if (farthestSensor < cs.getTrack(i)) {
+            farthestSensor = cs.getTrack(i);
+            farthestDirection = i;
+        }
+    }
+    this->distance = farthestSensor;
+    farthestDirection = -M_PI/2 + farthestDirection*M_PI/18;
+    return normalizeSteer(-farthestDirection);
+}
+
+inline float
+InsideTrack::normalizeSteer(float angle) {
+    const float maxsteer = 0.785398;
+    return angle/maxsteer;
+}
+
+/**************************************************************************
+ * Modularization*/
+inline float
+InsideTrack::get_steer(const CarState &cs) {
+    return isFacingWrongWay(cs) ? cs.getAngle() : findFarthestDirection(cs);
+}
+
+inline int
+InsideTrack::get_gear(const CarState &cs){
+    int gear = cs.getGear();
+    if(gear <= 0) return start_gear;
+
+    int rpm = cs.getRpm();
+
+    if(shouldIncreaseGear(gear, rpm)) ++gear;
+    else if(shouldDecreaseGear(gear, rpm)) --gear;
+
+    return gear;
+}
+
+inline float
+InsideTrack::get_accel(const CarState &cs){
+    setTargetSpeed(cs);
+    return cs.getSpeedX() > target_speed ? 0 : 1;
+}
+
+inline float
+InsideTrack::get_brake(const CarState &cs){
+    return cs.getSpeedX() > target_speed ? 0.3 : 0;
+}
+
+inline float
+InsideTrack::get_clutch(const CarState &cs){
+    return 0;
+}
+
+
+inline CarControl
+InsideTrack::drive(const CarState &cs) {
+    float steer = get_steer(cs);
+    setTargetSpeed(cs);
+    int gear = get_gear(cs);
+    float accel  = get_accel(cs);
+    float brake = get_brake(cs);
+    float clutch = get_clutch(cs);
+
+    return CarControl(accel, brake, gear, steer, clutch);
+}
+
 #endif // FSMDRIVER_STATE_INSIDETRACK_H
@@ -52,6 +52,9 @@ public:
                 int _arpm = 4000, int _hrpm = 9000, float _bs = 83,
                 float _sf = 1.4);
 
+    /** Name of the state, used in reports. */
+    const char *name() const;
+
     /**************************************************************************
     * Modularization*/
 
@@ -59,29 +62,29 @@ public:
     *calculated using angle value from cs, case not using the distance (highest track sensor value).
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     *@return A normalized steer value.*/
-    virtual float get_steer(CarState &cs);
+    virtual float get_steer(const CarState &cs);
 
     /** It receives the gear from cs, based on it and rpm it decreases or increases the gear.
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return The gear value accordingthe car's rpm.*/
-    virtual int get_gear(CarState &cs);
+    virtual int get_gear(const CarState &cs);
 
     /** It sets the target_speed based on cs, if the current speed is lower than the target_speed, 
     * it accelerates proportional to the perceived open space in front of the car, considering the 
     * average of the 5 front most track sensors.
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     *@return The average of the 5 front most track sensors.*/
-    virtual float get_accel(CarState &cs);
+    virtual float get_accel(const CarState &cs);
 
     /** It sets the target_speed based on cs, and decides if should applies 0.3 break intesity or no break.
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     *@return 0.3 if the current speed is higher than the target_speed and 1 if it is lower than the target_speed.*/
-    virtual float get_brake(CarState &cs);
+    virtual float get_brake(const CarState &cs);
 
     /** It recives the cs and calculates the clutch, always returning 0.
     *@param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     *@return Always 0. */
-    virtual float get_clutch(CarState &cs);
+    virtual float get_clutch(const CarState &cs);
 
     /**************************************************************************/
 
@@ -160,17 +163,17 @@ private:
 
     /** Changes the target_speed based on base_speed, speed_factor and distance.
     * @param cs a data structure cointaining information from the car's sensors.*/
-    void setTargetSpeed(CarState &cs);
+    void setTargetSpeed(const CarState &cs);
 
     /** Verifies if the car is driving the right path, once it is possible.
     * that the car collide and turn to the opposite way.
     * @param cs a data structure cointaining information from the car's sensors.*/
-    bool isFacingWrongWay(CarState &cs);
+    bool isFacingWrongWay(const CarState &cs);
 
     /** Find the highest value of the 19 track sensors.
     * @param cs a data structure cointaining information from the car's sensors.
     * @return the index of the track sensor with highest value.*/
-    float findFarthestDirection(CarState &cs);
+    float findFarthestDirection(const CarState &cs);
 
     /** It receive angle at radians (0.785398, -0.785398) and normalize it to -1 and 1.
     * @param angle a data from the car's sensor angle.
@@ -11,7 +11,6 @@
 #ifndef KNOWLEDGE_H
 #define KNOWLEDGE_H
 
-#include <vector>
 /**
  * @class Knowledge
  * @brief The Data Structure for Online Learning.
@@ -28,8 +27,5 @@ public:
     
     ~Knowledge();
 };
-// TODO retirar variavel global
-extern std::vector<Knowledge> memory;
-
 
 #endif // KNOWLEDGE_H
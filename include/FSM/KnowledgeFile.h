@@ -0,0 +1,86 @@
+/**  @file: KnowledgeFile.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#ifndef UNB_FSMDRIVER_KNOWLEDGE_FILE_H
+#define UNB_FSMDRIVER_KNOWLEDGE_FILE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Knowledge.h"
+#include "Landmarks.h"
+
+/** The landmarks of a track, kept between sessions in <track>.bin.
+ *
+ * The file is a HEADER_LEN bytes header followed by the landmarks, ordered
+ * by distance from the start (little-endian numbers):
+ *     - MAGIC, 8 bytes
+ *     - VERSION, 4 bytes
+ *     - the size of a landmark, 4 bytes (RECORD_LEN)
+ *     - the number of landmarks, 8 bytes
+ *     - the checksum of the landmarks, 8 bytes: a Fletcher checksum of
+ *       their 32 bit words (the sum of the words, and in the high half the
+ *       sum of those sums, both modulo 2^32)
+ *     - each landmark: targetSpeed and landmark, 4 byte floats
+ *
+ * A landmark has the layout of Knowledge, so on a little-endian host open()
+ * maps the file read-only and data() points into it: loading copies and
+ * parses nothing (the checksum and the order are checked in one pass).
+ * Files written before the header existed (a bare array of Knowledge) are
+ * still read, if they hold whole landmarks of finite, non-negative values.
+ * write() compacts the landmarks (see Landmarks.h), so the next session
+ * maps them as they are, and goes through a staging buffer of STAGING_LEN
+ * landmarks to a temporary file of its own (<path>.XXXXXX), renamed over
+ * the old one at the end, so a mapping of the old file stays valid and
+ * concurrent writers leave one of their files whole. */
+class KnowledgeFile {
+public:
+    static const char MAGIC[8];
+    static const unsigned int VERSION = 1;
+    static const size_t HEADER_LEN = 32;
+    static const size_t RECORD_LEN = 8;
+    /** Landmarks written at once. */
+    static const size_t STAGING_LEN = 4096;
+
+    KnowledgeFile();
+    /** Destructor, unmaps the file. */
+    ~KnowledgeFile();
+
+    /** Opens a knowledge file.
+     *
+     * @return false if it cannot be read, or is corrupted (then the object
+     * holds no landmarks). */
+    bool open(const char *path);
+
+    /** Unmaps the file. */
+    void close();
+
+    /** The landmarks of the file, ordered; valid until close. */
+    const Knowledge *data() const { return records; }
+    size_t size() const { return count; }
+
+    /** Writes landmarks to a knowledge file.
+     *
+     * @return false if it cannot be written. */
+    static bool write(const char *path, const Landmarks &landmarks);
+
+private:
+    const Knowledge *records;
+    size_t count;
+    /** The mapping, or the landmarks read when it cannot be mapped. */
+    void *mapped;
+    size_t mappedLen;
+    std::vector<Knowledge> copied;
+
+    KnowledgeFile(const KnowledgeFile &);
+    KnowledgeFile &operator=(const KnowledgeFile &);
+};
+
+#endif // UNB_FSMDRIVER_KNOWLEDGE_FILE_H
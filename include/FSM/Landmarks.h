@@ -0,0 +1,175 @@
+/**  @file: Landmarks.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#ifndef UNB_FSMDRIVER_LANDMARKS_H
+#define UNB_FSMDRIVER_LANDMARKS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <set>
+#include <vector>
+
+#include "Knowledge.h"
+
+/** The landmarks of the online learning, kept ordered by their distance
+ * from the start of the lap.
+ *
+ * The landmarks known at init are an ordered array the object does not
+ * own (the mapped knowledge file, see KnowledgeFile.h), so loading them is
+ * free. Those learnt since are in a balanced tree. Adding a landmark and
+ * finding the one ahead of the car are O(log n), so the driver can record
+ * a landmark on any tick however many it has learnt.
+ *
+ * Leaving the track at a corner lap after lap piles up landmarks a few
+ * metres apart, so they are compacted: the lap is cut in stretches of
+ * radius metres, and the landmarks of a stretch are merged into the first
+ * one, with their lowest target speed. The landmark kept is less than
+ * radius metres before each of those it stands for (the caps only get
+ * earlier and lower), however often they are merged again. The landmarks
+ * learnt are compacted a few at a time (compact(), called every tick), so
+ * no tick pays for a whole pass, and those known at init are compacted
+ * when assigned, if the file they come from is not. There are never more
+ * than limit landmarks: those known at init are compacted (with a growing
+ * radius) to half of it, and once it is reached a new landmark is merged
+ * into the nearest one learnt. */
+class Landmarks {
+private:
+    struct ByLandmark {
+        bool operator()(const Knowledge &l, const Knowledge &r) const { return l.landmark < r.landmark; }
+    };
+    typedef std::multiset<Knowledge, ByLandmark> tset;
+
+public:
+    /** Default merge radius, in metres, and limit on the landmarks. */
+    static const float RADIUS;
+    static const size_t LIMIT = 1 << 16;
+
+    Landmarks() : base(NULL), baseCount(0), radius(RADIUS), limit(LIMIT), cursor(added.end()),
+                  sweeping(false), inserted(false) {}
+
+    /** Sets the compaction, for the landmarks assigned and added after.
+     *
+     * @param radius length of the stretches whose landmarks are merged
+     * (0 merges those at the same distance only).
+     * @param limit most landmarks kept (at least 2). */
+    void setCompaction(float radius, size_t limit);
+
+    /** Adds a landmark, O(log n). */
+    void insert(const Knowledge &k);
+
+    /** Replaces the landmarks with n ordered ones. If they are compact they
+     * are not copied, and must stay valid while the object uses them. */
+    void assign(const Knowledge *k, size_t n);
+
+    /** Compacts the landmarks learnt, going on from where the last call
+     * stopped. A step merges or drops a landmark, or moves on to the next
+     * one (O(log n) at worst, O(1) amortized). A pass over them starts again only if some were added
+     * since the last one began.
+     *
+     * @param steps most steps to do.
+     * @return whether there is compaction left to do. */
+    bool compact(unsigned int steps);
+
+    /** Copies the landmarks, ordered, to out. */
+    void copy(std::vector<Knowledge> &out) const;
+
+    /** Calls f on every landmark, ordered. */
+    template <typename F>
+    void forEach(F f) const {
+        const Knowledge *b = base, *bEnd = base + baseCount;
+        tset::const_iterator a = added.begin();
+        while (b != bEnd || a != added.end()) {
+            if (a == added.end() || (b != bEnd && !ByLandmark()(*a, *b))) f(*b++);
+            else f(*a++);
+        }
+    }
+
+    /** Calls f on the landmarks, ordered and merged as by compact() (those
+     * left in place by the passes, or learnt since the last one, too). */
+    template <typename F>
+    void forEachCompacted(F f) const {
+        bool run = false;
+        Knowledge first(0, 0);
+        forEach([&](const Knowledge &k) {
+            if (run && together(first, k)) {
+                first.targetSpeed = std::min(first.targetSpeed, k.targetSpeed);
+                return;
+            }
+            if (run) f(first);
+            first = k;
+            run = true;
+        });
+        if (run) f(first);
+    }
+
+    /** The nearest landmark at or ahead of a distance from the start: past
+     * the last landmark of the lap it is the first one of the next lap.
+     * O(log n).
+     *
+     * @param distFromStart where the car is.
+     * @return the landmark, or NULL if there is none. */
+    const Knowledge *ahead(float distFromStart) const;
+
+    /** How far ahead a landmark is, the lap wrapping around.
+     *
+     * @param distFromStart where the car is.
+     * @param k a landmark (from ahead).
+     * @param lapLength the length of the track.
+     * @return the distance, in [0, lapLength). */
+    static float distance(float distFromStart, const Knowledge &k, float lapLength) {
+        float d = k.landmark - distFromStart;
+        return d < 0 ? d + lapLength : d;
+    }
+
+    /** Whether n landmarks are ordered (as assign needs them). */
+    static bool ordered(const Knowledge *k, size_t n);
+
+    size_t size() const { return baseCount + added.size(); }
+    bool empty() const { return size() == 0; }
+    void clear() { assign(NULL, 0); }
+
+private:
+    /** The landmarks known at init, not owned, and those learnt since. */
+    const Knowledge *base;
+    size_t baseCount;
+    tset added;
+    /** The landmarks known at init, when they had to be compacted. */
+    std::vector<Knowledge> owned;
+
+    float radius;
+    size_t limit;
+    /** The landmark learnt the compaction pass is at, whether a pass is
+     * on, and whether landmarks were added since it began. */
+    tset::iterator cursor;
+    bool sweeping, inserted;
+
+    /** Merges a landmark into the nearest one learnt. */
+    void merge(const Knowledge &k);
+
+    /** Whether two landmarks are in the same stretch. */
+    bool together(const Knowledge &l, const Knowledge &r) const {
+        return radius > 0 ? floorf(l.landmark / radius) == floorf(r.landmark / radius)
+                          : l.landmark == r.landmark;
+    }
+
+    /** Whether a landmark known at init, in the stretch of k, is as slow. */
+    bool covered(const Knowledge &k) const;
+
+    /** The first landmark, and the first at or after a distance (NULL if
+     * there is none). */
+    const Knowledge *first() const;
+    const Knowledge *from(float distFromStart) const;
+
+    Landmarks(const Landmarks &);
+    Landmarks &operator=(const Landmarks &);
+};
+
+#endif // UNB_FSMDRIVER_LANDMARKS_H
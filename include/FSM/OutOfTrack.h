@@ -55,7 +55,10 @@ public:
     @param cs the driver's perception of the environment. 
     @return A CarControl with correct values for the actuators.
     */
-    CarControl drive(CarState &);
+    CarControl drive(const CarState &);
+
+    /** Name of the state, used in reports. */
+    const char *name() const;
 
     /**************************************************************************/
 
@@ -63,29 +66,29 @@ public:
     * border the car is, and angle sensor that allow to know which side to turn the steer.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return -1 or 1 to Steer value, full right and full left respectively, according to the track border. */
-    virtual float get_steer(CarState &cs);
+    virtual float get_steer(const CarState &cs);
 
     /** It receives cs and calculates the gear based on the current speed and the speed limits to each gear, that way
     * high speed need high gear. Please note that this state does not use rpm to obtain gear.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return The gear value accordingthe car's current speed.*/
-    virtual int get_gear(CarState &cs);
+    virtual int get_gear(const CarState &cs);
 
     /** It calculates the acceleration based on the speedY from cs and the proportinal factor negative_accel_percent.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return Virtual gas pedal intensity proportional to the speedY.*/
-    virtual float get_accel(CarState &cs);
+    virtual float get_accel(const CarState &cs);
 
     /** It calculates the brake based on the speedX, speedY from cs and max_skidding.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return 0.1 if the car's speedY is higher than max_skidding,
     * 1 when the car's speedX is negative, and 0 for other cases.*/
-    virtual float get_brake(CarState &cs);
+    virtual float get_brake(const CarState &cs);
 
     /** It recives the cs and calculates the clutch, always returning 0.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return Always 0. */
-    virtual float get_clutch(CarState &cs);
+    virtual float get_clutch(const CarState &cs);
 
     /**************************************************************************/
 
@@ -118,4 +121,56 @@ private:
     
 };
 
+/* The per-tick methods are defined here so that a driver which knows the
+ * state type (see StaticFSM.h) can inline them. */
+inline float
+OutOfTrack::get_steer(const CarState &cs) {
+    float angle = cs.getAngle();
+    if(cs.getTrackPos() > 0){
+        if(angle > max_return_angle) return 1;
+        if(angle < min_return_angle) return -1;
+    } else {
+        if(angle < -(max_return_angle)) return -1;
+        if(angle > -(min_return_angle)) return 1;
+    }
+
+    return 0;
+}
+
+inline int
+OutOfTrack::get_gear(const CarState &cs) {
+    if(cs.getSpeedX() > velocity_gear_4) return cs.getGear(); 
+                                                            /* @todo need reverse behavior */
+    if(cs.getSpeedX() > velocity_gear_3) return 3;
+    if(cs.getSpeedX() > velocity_gear_2) return 2;
+
+    return 1;
+}
+
+inline float
+OutOfTrack::get_accel(const CarState &cs) {
+    return(1-abs(cs.getSpeedY())*negative_accel_percent); /* @todo can be negative, need some fix */
+}
+
+inline float
+OutOfTrack::get_brake(const CarState &cs) {
+    if(cs.getSpeedX() < 0) return 1;
+    if(abs(cs.getSpeedY()) > max_skidding) return 0.1;
+
+    return 0;
+}
+
+inline float
+OutOfTrack::get_clutch(const CarState &cs){
+    return 0;
+}
+
+inline CarControl
+OutOfTrack::drive(const CarState &cs) {
+    const float clutch = 0;
+    const int focus = 0, meta = 0;
+
+    return CarControl(get_accel(cs), get_brake(cs), get_gear(cs), get_steer(cs), clutch, focus, meta);
+}
+
 #endif // UNB_FSMDRIVER_STATE_OUT_OF_TRACK_H
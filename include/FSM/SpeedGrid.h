@@ -0,0 +1,112 @@
+/**  @file: SpeedGrid.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#ifndef UNB_FSMDRIVER_SPEED_GRID_H
+#define UNB_FSMDRIVER_SPEED_GRID_H
+
+#include <cmath>
+#include <vector>
+
+#include "Landmarks.h"
+
+/** The speed caps the landmarks put on the track ahead, for the driving
+ * states to read in constant time.
+ *
+ * The lap is cut in bins of binLength metres. Each bin keeps the lowest
+ * target speed of the landmarks in it and the lowest of those in the
+ * lookahead metres from it, so cap() is one division and one load. The
+ * bins are updated as landmarks are added (O(lookahead/binLength) each),
+ * as caps only go down.
+ *
+ * The lap length is not among the sensors: the grid covers the farthest
+ * distance from the start it has been shown (reach()), and learns that this
+ * is the lap when the car crosses the start line, its distance dropping
+ * from the last bins to the first ones (the cars start behind the line, so
+ * within seconds of the start). Only then does the lookahead of the last
+ * bins wrap to the start of the lap; until then a bin sees only the bins
+ * ahead of it. */
+class SpeedGrid {
+public:
+    /** Constructor.
+     *
+     * @param binLength metres per bin.
+     * @param lookahead metres ahead a landmark caps the speed. */
+    SpeedGrid(float binLength = 10, float lookahead = 100);
+
+    /** Lowest target speed of the landmarks in the lookahead metres from a
+     * distance, INFINITY if there is none. O(1).
+     *
+     * @param distFromStart where the car is. */
+    float cap(float distFromStart) const {
+        unsigned int b = bin(distFromStart);
+        return b < ahead.size() ? ahead[b] : INFINITY;
+    }
+
+    /** Extends the grid to where the car is, if it is farther than it
+     * covers, and takes what it covers as the lap when the car crosses the
+     * start line (the drivers call it every tick, so the grid learns the
+     * lap length). A distance that is negative, not finite or longer than
+     * MAX_LENGTH is ignored.
+     *
+     * @param distFromStart where the car is. */
+    void reach(float distFromStart) {
+        if (!(distFromStart >= 0 && distFromStart < MAX_LENGTH))
+            return;
+        unsigned int b = bin(distFromStart);
+        if (b >= caps.size())
+            grow(b + 1);
+        else if (!wraps && b < window && last + window >= caps.size() && caps.size() > window)
+            close();
+        last = b;
+    }
+
+    /** Adds the cap of a landmark. */
+    void add(const Knowledge &k);
+
+    /** Rebuilds the grid from landmarks. */
+    void assign(const Landmarks &landmarks);
+
+    float getBinLength() const { return binLength; }
+    /** Length of the lap the grid covers so far. */
+    float getLength() const { return caps.size() * binLength; }
+    /** Whether the lap length is known, so the lookahead wraps. */
+    bool isLap() const { return wraps; }
+
+    /** Longest distance from the start taken, in metres (the longest
+     * tracks are about 20 km): farther ones are garbage, and would cost a
+     * bin per binLength. */
+    static const unsigned int MAX_LENGTH = 100000;
+
+private:
+    float binLength;
+    /** Bins in the lookahead. */
+    unsigned int window;
+    /** Whether the grid covers the whole lap, and the bin of the car at the
+     * last reach(). */
+    bool wraps;
+    unsigned int last;
+    /** Lowest speed of the landmarks of each bin, and of each window. */
+    std::vector<float> caps, ahead;
+
+    unsigned int bin(float distFromStart) const {
+        return distFromStart > 0 ? (unsigned int) (distFromStart / binLength) : 0;
+    }
+
+    /** Extends the grid to bins bins. */
+    void grow(unsigned int bins);
+
+    /** Takes the bins as the lap, wrapping the windows of the last ones. */
+    void close();
+
+    /** Recomputes ahead for the bins of [from, to). */
+    void refresh(unsigned int from, unsigned int to);
+};
+
+#endif // UNB_FSMDRIVER_SPEED_GRID_H
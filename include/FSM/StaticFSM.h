@@ -0,0 +1,155 @@
+/**  @file: StaticFSM.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#ifndef UNB_FSMDRIVER_STATIC_FSM_H
+#define UNB_FSMDRIVER_STATIC_FSM_H
+
+#include <cassert>
+#include <tuple>
+
+#include "CarControl.h"
+#include "CarState.h"
+
+/** Position of the state type S in the list States (it does not compile if S
+ * is not in the list). */
+template <typename S, typename... States>
+struct StateIndex;
+
+template <typename S, typename... Rest>
+struct StateIndex<S, S, Rest...> {
+    static const unsigned int value = 0;
+};
+
+template <typename S, typename First, typename... Rest>
+struct StateIndex<S, First, Rest...> {
+    static const unsigned int value = 1 + StateIndex<S, Rest...>::value;
+};
+
+/** Calls state I of the tuple Tuple if it is the current one, else goes on
+ * with the next; the last state (and StateVisit<Tuple, I, true>) is called
+ * without checking. The calls name the state type, so they are not virtual
+ * and the whole visit can be inlined. */
+template <typename Tuple, unsigned int I, bool LAST = (I+1 == std::tuple_size<Tuple>::value)>
+struct StateVisit {
+    static CarControl drive(Tuple &states, unsigned int current, const CarState &cs) {
+        if (current == I) return StateVisit<Tuple, I, true>::drive(states, current, cs);
+        return StateVisit<Tuple, I+1>::drive(states, current, cs);
+    }
+    static CarControl fallback(const Tuple &states, unsigned int current, const CarControl &last) {
+        if (current == I) return StateVisit<Tuple, I, true>::fallback(states, current, last);
+        return StateVisit<Tuple, I+1>::fallback(states, current, last);
+    }
+    static const char *name(const Tuple &states, unsigned int current) {
+        if (current == I) return StateVisit<Tuple, I, true>::name(states, current);
+        return StateVisit<Tuple, I+1>::name(states, current);
+    }
+};
+
+template <typename Tuple, unsigned int I>
+struct StateVisit<Tuple, I, true> {
+    typedef typename std::tuple_element<I, Tuple>::type State;
+
+    static CarControl drive(Tuple &states, unsigned int current, const CarState &cs) {
+        assert(current == I);
+        return std::get<I>(states).State::drive(cs);
+    }
+    static CarControl fallback(const Tuple &states, unsigned int current, const CarControl &last) {
+        assert(current == I);
+        return std::get<I>(states).State::fallback(last);
+    }
+    static const char *name(const Tuple &states, unsigned int current) {
+        assert(current == I);
+        return std::get<I>(states).State::name();
+    }
+};
+
+/** A Finite State Machine whose set of states is known at compile time.
+ *
+ * The states are held by value and the current one is kept as its position
+ * in the list, so driving is one inlined visit instead of a virtual drive
+ * (and the virtual actuator calls it makes) through a DrivingState pointer.
+ * The states are the usual DrivingState classes; those whose per-tick
+ * methods are defined in their header are inlined entirely.
+ *
+ *     StaticFSM<InsideTrack, OutOfTrack, Stuck> fsm;
+ *     if (fsm.get<Stuck>().isStuck(cs)) fsm.changeTo<Stuck>();
+ *     CarControl cc = fsm.drive(cs);
+ *
+ * The first state of the list is the initial one. */
+template <typename... States>
+class StaticFSM {
+public:
+    typedef std::tuple<States...> tstates;
+
+    /** Number of states. */
+    static const unsigned int STATES_NUM = sizeof...(States);
+
+    /** Constructor, in the first state. */
+    StaticFSM() : current(0), previous(0) {}
+
+    /** The state of type S. */
+    template <typename S>
+    S &get() { return std::get<StateIndex<S, States...>::value>(states); }
+
+    /** Whether the FSM is in the state of type S. */
+    template <typename S>
+    bool isIn() const { return current == StateIndex<S, States...>::value; }
+
+    /** Changes the FSM's current state to the state of type S. */
+    template <typename S>
+    void changeTo() {
+        previous = current;
+        current = StateIndex<S, States...>::value;
+    }
+
+    /** Position of the state type S in the list, to name it at run time
+     * (as the target of a TransitionTable). */
+    template <typename S>
+    static unsigned int indexOf() { return StateIndex<S, States...>::value; }
+
+    /** Position of the current state. */
+    unsigned int at() const { return current; }
+
+    /** Changes the FSM's current state to the one at a position. */
+    void changeTo(unsigned int state) {
+        assert(state < STATES_NUM);
+        previous = current;
+        current = state;
+    }
+
+    /** Changes the FSM's current state to its previous state. */
+    void revertState() {
+        unsigned int state = previous;
+        previous = current;
+        current = state;
+    }
+
+    /** The current state's drive. */
+    CarControl drive(const CarState &cs) {
+        return StateVisit<tstates, 0>::drive(states, current, cs);
+    }
+
+    /** The current state's fallback. */
+    CarControl fallback(const CarControl &last) const {
+        return StateVisit<tstates, 0>::fallback(states, current, last);
+    }
+
+    /** The current state's name. */
+    const char *name() const {
+        return StateVisit<tstates, 0>::name(states, current);
+    }
+
+private:
+    tstates states;
+    /** Positions in States of the current and previous states. */
+    unsigned int current, previous;
+};
+
+#endif // UNB_FSMDRIVER_STATIC_FSM_H
@@ -52,7 +52,10 @@ public:
     @param cs the driver's perception of the environment. 
     @return A CarControl with correct values for the actuators.
     */
-    CarControl drive(CarState &);
+    CarControl drive(const CarState &);
+
+    /** Name of the state, used in reports. */
+    const char *name() const;
 
     /**************************************************************************/
 
@@ -60,27 +63,27 @@ public:
     * in relation to the track and the track's initial position.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return -1 or 1 at stuck in order to fast turn to right way. */
-    virtual float get_steer(CarState &cs);
+    virtual float get_steer(const CarState &cs);
 
     /** Receives cs and returns the reverse gear.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return Always -1.*/
-    virtual int get_gear(CarState &cs);
+    virtual int get_gear(const CarState &cs);
 
     /** Recives cs and returns full acceleration.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return Always 1.*/
-    virtual float get_accel(CarState &cs);
+    virtual float get_accel(const CarState &cs);
 
     /** Recives cs and return no brake.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return Always 0.*/
-    virtual float get_brake(CarState &cs);
+    virtual float get_brake(const CarState &cs);
 
     /** It recives the cs and calculates the clutch, always returning 0.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return Always 0. */
-    virtual float get_clutch(CarState &cs);
+    virtual float get_clutch(const CarState &cs);
 
     /**************************************************************************/
 
@@ -91,7 +94,7 @@ public:
      *
      * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
      * @return True if the controller is stuck, false otherwise. */
-    bool isStuck(CarState &cs);
+    bool isStuck(const CarState &cs);
 
     /** Auxiliar funcion to set class attributes*/
     void setParameters(float ss, int mrd, int mst, int msst);
@@ -113,12 +116,12 @@ private:
     /** Checks if the stuck state is appropriate to the event at the race.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return True if the car has been at bellow the stuck_speed for long enough and false if not.*/
-    bool seemsStuck(CarState &cs);
+    bool seemsStuck(const CarState &cs);
 
     /** Based on the distance raced it verifies if the driver has just started the race.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return True if the pilot is at begining of the race or false if not.*/
-    bool justStartedRace(CarState &cs);
+    bool justStartedRace(const CarState &cs);
 
     /** Checks if the car is driving according the race direction.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
@@ -129,7 +132,7 @@ private:
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * is the sensors value of the angle between the car direction and race direction.
     * @return True if the car is not stuck anymore or false if it is.*/
-    bool notStuckAnymore(CarState &cs);
+    bool notStuckAnymore(const CarState &cs);
 
     /** Since the driver can not be stuck for a long time without goint back the track, a time limit is used,
     * this checks if the stuck state surpass that limit.
@@ -140,12 +143,12 @@ private:
     /**function to determine the steer.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return -1 or 1 at stuck in order to fast turn to right way.*/
-    float auxSteer(float trackInitialPos, CarState &cs);
+    float auxSteer(float trackInitialPos, const CarState &cs);
 
     /**Function to determine the track_pos at the begin of stuck state.
     * @param cs A data structure cointaining information from the car's sensors, the driver's perception of the environment.
     * @return The track_initial_pos or the current track position.*/
-    float getInitialPos(CarState &cs);
+    float getInitialPos(const CarState &cs);
 
     /**  Ticks'counter incremented when the car has been bellow the stuck_speed.*/
     unsigned int elapsed_ticks;
@@ -158,4 +161,112 @@ private:
 
 };
 
+/* The per-tick methods are defined here so that a driver which knows the
+ * state type (see StaticFSM.h) can inline them. */
+inline bool
+Stuck::justStartedRace(const CarState &cs) {
+    return (cs.getDistRaced() <= minimum_distance_raced);
+}
+
+inline bool
+Stuck::onRightWay(float track_pos, float angle) {
+    return (((track_pos < 0) && (angle > -M_PI/2) && (angle < 0)) ||
+            ((track_pos > 0) && (angle < M_PI/2) && (angle > 0)) ||
+            ((track_pos > 1) && (angle > 0))||
+            ((track_pos < -1) && (angle < 0)));
+}
+
+inline bool
+Stuck::notStuckAnymore(const CarState &cs) {
+    return onRightWay(cs.getTrackPos(), cs.getAngle());
+}
+
+inline bool
+Stuck::hasBeenStuckLongEnough() {
+    return (elapsed_ticks >= maximum_number_of_ticks_stuck);
+}
+
+inline bool
+Stuck::isStuck(const CarState &cs) {
+    return (seemsStuck(cs) && !justStartedRace(cs));
+}
+
+inline bool
+Stuck::seemsStuck(const CarState &cs) {
+    if(cs.getSpeedX() < stuck_speed)
+        ++slow_speed_ticks;
+    else
+        slow_speed_ticks = 0;
+
+    if(notStuckAnymore(cs))
+        slow_speed_ticks = 0;
+
+    return (slow_speed_ticks > maximum_number_of_ticks_in_slow_speed);
+}
+
+inline float
+Stuck::getInitialPos(const CarState &cs) {
+	return (track_initial_pos == 0 ? cs.getTrackPos() : track_initial_pos);
+}
+
+inline float
+Stuck::auxSteer(float track_initial_pos, const CarState &cs){
+    if(abs(cs.getAngle()) > M_PI) // around 180 graus
+        return (track_initial_pos > 0 ? -1 : 1);
+
+    return (track_initial_pos > 0 ? 1 : -1);
+}
+
+/**************************************************************************
+ * Modularization*/
+inline float
+Stuck::get_steer(const CarState &cs) {
+    if(abs(cs.getAngle()) > M_PI) // around 180 graus
+    return (getInitialPos(cs) > 0 ? -1 : 1);
+
+    return (getInitialPos(cs) > 0 ? 1 : -1);
+}
+
+inline int
+Stuck::get_gear(const CarState &cs){
+    return -1;
+}
+
+inline float
+Stuck::get_accel(const CarState &cs){
+    return 1;
+}
+
+inline float
+Stuck::get_brake(const CarState &cs){
+    return 0;
+}
+
+inline float
+Stuck::get_clutch(const CarState &cs){
+    return 0;
+}
+
+inline CarControl
+Stuck::drive(const CarState &cs) {
+    ++elapsed_ticks;
+
+    track_initial_pos = getInitialPos(cs);
+
+    if(notStuckAnymore(cs) || hasBeenStuckLongEnough()) {
+        elapsed_ticks = 0;
+        slow_speed_ticks = 0;
+        track_initial_pos = 0;
+    }
+
+    int gear = get_gear(cs);
+    float accel  = get_accel(cs);
+    float brake = get_brake(cs);
+    float clutch = get_clutch(cs);
+    const int focus = 0, meta = 0;
+    float steer = auxSteer(track_initial_pos, cs);
+
+    return CarControl(accel, brake, gear, steer, clutch, focus, meta);
+}
+
 #endif // UNB_FSMDRIVER_STATE_STUCK_H
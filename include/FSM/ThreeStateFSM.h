@@ -0,0 +1,80 @@
+/**  @file: ThreeStateFSM.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#ifndef UNB_FSMDRIVER_THREE_STATE_FSM_H
+#define UNB_FSMDRIVER_THREE_STATE_FSM_H
+
+#include <cmath>
+
+#include "CarState.h"
+#include "Knowledge.h"
+#include "OutOfTrack.h"
+#include "Stuck.h"
+#include "TransitionTable.h"
+
+/** What the Three-State FSM drivers share: the parameters of their states,
+ * evolved with a Genetic Algorithm, and their transitions. FSMDriver3 and
+ * FSMDriver3S differ only in how they hold their states, so they drive
+ * alike as long as both take these. */
+struct ThreeStateFSM {
+    /** Sets the states' parameters for road tracks.
+     *
+     * @tparam Inside InsideTrack or InsideTrackA. */
+    template <typename Inside>
+    static void setROAD(Inside &inside_track, OutOfTrack &out_of_track, Stuck &stuck) {
+        inside_track.setParameters(1, 2, 6956, 3728, 9411, 84.131, 0.973418);
+        out_of_track.setParameters(32.0151, 0.146842, 165, 129, 368, 0.159876, 0.0839129);
+        stuck.setParameters(5, 100, 300, 50);
+    }
+
+    /** Sets the states' parameters for dirt tracks. */
+    template <typename Inside>
+    static void setDIRT(Inside &inside_track, OutOfTrack &out_of_track, Stuck &stuck) {
+        inside_track.setParameters(1, 4, 1796, 1857, 4340, 94.5951, 0.962757);
+        out_of_track.setParameters(395.807, 0.0439577, 114, 113, 251, 0.0753426, 0.534217);
+        stuck.setParameters(5, 100, 300, 50);
+    }
+
+    /** The transitions, declared in a table and compiled: stuck first, then
+     * inside the track, else out of it (leaving the track fast is a
+     * landmark of the online learning).
+     *
+     * @tparam Driver has stuckState() and addLandmark().
+     * @tparam Target how the driver names its states.
+     * @param table the driver's table.
+     * @param stuck, inside, out the targets of the three states. */
+    template <typename Driver, typename Target>
+    static void transitions(TransitionTable<Driver, Target> &table, typename TransitionTable<Driver, Target>::ttarget stuck,
+                            typename TransitionTable<Driver, Target>::ttarget inside,
+                            typename TransitionTable<Driver, Target>::ttarget out) {
+        unsigned int STUCK = table.guard(&Rules<Driver>::isStuck);
+        unsigned int ON_TRACK = table.guard(&Rules<Driver>::onTrack);
+        unsigned int FAST = table.guard(&Rules<Driver>::fast);
+        table.rule(2, STUCK, 0, stuck);
+        table.rule(1, ON_TRACK, 0, inside);
+        table.rule(0, FAST, 0, out, &Rules<Driver>::learn);
+        table.rule(0, 0, 0, out);
+        table.compile();
+    }
+
+private:
+    /** Guards and actions of the transitions. */
+    template <typename Driver>
+    struct Rules {
+        static bool isStuck(Driver &d, const CarState &cs) { return d.stuckState().isStuck(cs); }
+        static bool onTrack(Driver &, const CarState &cs) { return cs.getTrack(1) > 0; }
+        static bool fast(Driver &, const CarState &cs) { return cs.getSpeedX() > 85; }
+        static void learn(Driver &d, const CarState &cs) {
+            d.addLandmark(Knowledge(std::abs(cs.getSpeedX())*0.9, cs.getDistFromStart()));
+        }
+    };
+};
+
+#endif // UNB_FSMDRIVER_THREE_STATE_FSM_H
@@ -0,0 +1,78 @@
+/**  @file: TrackProfile.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#ifndef UNB_FSMDRIVER_TRACK_PROFILE_H
+#define UNB_FSMDRIVER_TRACK_PROFILE_H
+
+#define UNKN   0
+#define ROAD   1
+#define DIRT   2
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+/** The surface of the track (UNKN, ROAD or DIRT), found in the warmup and
+ * kept in a file for the qualifying and the race.
+ *
+ * The surface is resolved once per track name and cached for every driver
+ * of the process, so the control loop never touches the file. When the
+ * file is watched, a thread blocked on inotify (Linux) notes its edits and
+ * changed() tells the driver to load it again. */
+class TrackProfile {
+public:
+    /** Constructor.
+     *
+     * @param path the file the surface is kept in. */
+    TrackProfile(const char *path = "road_dirt.txt");
+
+    /** Destructor, stops the watch. */
+    ~TrackProfile();
+
+    /** Surface of a track: the cached one, else the one in the file (then
+     * cached).
+     *
+     * @param trackName the track.
+     * @return UNKN, ROAD or DIRT. */
+    int load(const char *trackName);
+
+    /** Records the surface of a track: it is cached and written to the file.
+     *
+     * @param trackName the track.
+     * @param surface ROAD or DIRT. */
+    void save(const char *trackName, int surface);
+
+    /** Starts watching the file for edits.
+     *
+     * @return false if it cannot be watched. */
+    bool watch();
+
+    /** Whether the file was edited since the last load. It is one atomic
+     * read, and always false if the file is not watched. */
+    bool changed() const { return edits.load(std::memory_order_relaxed) != loaded; }
+
+private:
+    std::string path;
+    /** Edits seen by the watch, and their number at the last load. */
+    std::atomic<unsigned int> edits;
+    unsigned int loaded;
+
+    /** inotify descriptor and the pipe that stops the watch. */
+    int notifyFd, stopFd[2];
+    std::thread watcher;
+
+    /** Body of the watch thread. */
+    void run();
+
+    TrackProfile(const TrackProfile &);
+    TrackProfile &operator=(const TrackProfile &);
+};
+
+#endif // UNB_FSMDRIVER_TRACK_PROFILE_H
@@ -0,0 +1,137 @@
+/**  @file: TransitionTable.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#ifndef UNB_FSMDRIVER_TRANSITION_TABLE_H
+#define UNB_FSMDRIVER_TRANSITION_TABLE_H
+
+#include <cassert>
+#include <vector>
+
+#include "CarState.h"
+
+/** The transitions of a FSM driver declared as data: guards on the sensors,
+ * and rules that pick a target state when some guards hold and others do
+ * not, the highest priority first.
+ *
+ *     TransitionTable<FSMDriver3, DrivingState *> table;
+ *     unsigned int STUCK = table.guard(&isStuck), ON_TRACK = table.guard(&onTrack);
+ *     table.rule(2, STUCK, 0, &stuck);
+ *     table.rule(1, ON_TRACK, 0, &inside_track);
+ *     table.rule(0, 0, 0, &out_of_track);
+ *     table.compile();
+ *     ...
+ *     const TransitionTable<FSMDriver3, DrivingState *>::tentry &to = table.evaluate(*this, cs);
+ *
+ * compile() resolves the rules for every combination of guard results, so
+ * evaluating is calling each guard once, in the order they were added, and
+ * indexing a table with their results: no rule is tested at run time, and
+ * a guard used by several rules is still called once. As every guard is
+ * called every tick, those with side effects (Stuck::isStuck counts the
+ * slow ticks) behave as in a transition that always tests them first.
+ *
+ * @tparam Driver the driver the guards and actions are called on.
+ * @tparam Target what a rule selects (a state pointer, index...). */
+template <typename Driver, typename Target>
+class TransitionTable {
+public:
+    /** A condition on the sensors. */
+    typedef bool (*tguard)(Driver &d, const CarState &cs);
+    /** Something to do when a rule is taken. */
+    typedef void (*taction)(Driver &d, const CarState &cs);
+
+    typedef Target ttarget;
+
+    /** What a combination of guard results leads to. */
+    typedef struct {
+        /** Whether a rule matched (else the FSM stays in its state). */
+        bool matched;
+        Target target;
+        /** Called with the transition, or NULL. */
+        taction action;
+        /** Position of the rule in the order they were added. */
+        unsigned int rule;
+    } tentry;
+
+    /** Most guards a table can have (its size is 2^GUARDS_MAX entries). */
+    static const unsigned int GUARDS_MAX = 8;
+
+    TransitionTable() : compiled(false) {}
+
+    /** Adds a guard.
+     *
+     * @param g the guard.
+     * @return its bit, to combine in the when and unless masks of rules. */
+    unsigned int guard(tguard g) {
+        assert(!compiled && guards.size() < GUARDS_MAX);
+        guards.push_back(g);
+        return 1u << (guards.size()-1);
+    }
+
+    /** Adds a rule: when the guards of when hold and none of unless does,
+     * go to target. Among the rules that match, the highest priority wins,
+     * then the first added.
+     *
+     * @param priority the rule's priority.
+     * @param when the guards (bits) that must hold.
+     * @param unless the guards (bits) that must not.
+     * @param target where the rule goes.
+     * @param action called when the rule is taken, or NULL. */
+    void rule(int priority, unsigned int when, unsigned int unless, Target target, taction action = NULL) {
+        assert(!compiled && (when & unless) == 0);
+        trule r = {priority, when, unless, {true, target, action, (unsigned int) rules.size()}};
+        rules.push_back(r);
+    }
+
+    /** Resolves the rules for every combination of guard results. */
+    void compile() {
+        entries.assign(1u << guards.size(), tentry());
+        for (unsigned int results = 0; results < entries.size(); ++results) {
+            const trule *best = NULL;
+            for (size_t r = 0; r < rules.size(); ++r) {
+                const trule &candidate = rules[r];
+                if ((results & candidate.when) == candidate.when && (results & candidate.unless) == 0
+                    && (best == NULL || candidate.priority > best->priority))
+                    best = &candidate;
+            }
+            entries[results] = best ? best->entry : tentry();
+        }
+        compiled = true;
+    }
+
+    /** Calls every guard once and looks up their results.
+     *
+     * @param d the driver the guards are called on.
+     * @param cs the sensors.
+     * @param held if not NULL, gets the guards that held (bits).
+     * @return where to go; the caller changes state and calls the action. */
+    const tentry &evaluate(Driver &d, const CarState &cs, unsigned int *held = NULL) const {
+        assert(compiled);
+        unsigned int results = 0;
+        for (size_t g = 0; g < guards.size(); ++g)
+            results |= (unsigned int) guards[g](d, cs) << g;
+        if (held) *held = results;
+        return entries[results];
+    }
+
+private:
+    typedef struct {
+        int priority;
+        unsigned int when, unless;
+        tentry entry;
+    } trule;
+
+    std::vector<tguard> guards;
+    std::vector<trule> rules;
+    /** The entry of every combination of guard results, indexed by them. */
+    std::vector<tentry> entries;
+    bool compiled;
+};
+
+#endif // UNB_FSMDRIVER_TRANSITION_TABLE_H
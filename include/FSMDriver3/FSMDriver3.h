@@ -20,6 +20,8 @@
 #include "Stuck.h"
 #include "FSMDriver.h"
 #include "Knowledge.h"
+#include "ThreeStateFSM.h"
+#include "TransitionTable.h"
 
 /** @class FSMDriver3
 *   @brief The driver itself.
@@ -39,22 +41,14 @@ private:
     OutOfTrack out_of_track;
     Stuck stuck;
 
+    /** The transitions between the states (see ThreeStateFSM.h), compiled
+     * by the constructor. */
+    TransitionTable<FSMDriver3, DrivingState *> transitions;
+
 public:
-    /** Called when the driver finishes the race. */
-    virtual void onShutdown();
-    /** Called when TORCS asks a race restart. */
-    virtual void onRestart();
+    /** The stuck state, for the transitions. */
+    Stuck &stuckState() { return stuck; }
 
-    /**
-     * @brief init angles of range finders.
-     * @details In order to maximize the efficiency of the information received from
-     * the track, the vector of sensors in the Three-State FSM was initialized
-     * according to a normal distribution, i.e., the sensors are more
-     * densely distributed in front of car and less on the sides.
-     * 
-     * @param angles values in degrees of the range finders.
-     */
-    virtual void init(float *angles);
     /** Empty constructor. */
     FSMDriver3();
     /** Empty destructor */
@@ -64,9 +58,10 @@ public:
     *   This method decides whenever the current state does not fit with the car status and needs to be changed.The transition choose the most fitted state at the moment of the race.
     *   The transition check if the car is stuck by the it's speed, if it is lower than certain value for long enough it is stuck, if it is not, the function check the car is inside or
     *   out side the track using tracks sensors than choosing the appropriate state.
+    *   The choice is made by a TransitionTable, which calls each of these checks once.
     *	@param cs a data structure cointaining information from the car's sensors.
     */
-    void transition(CarState &cs);
+    void transition(const CarState &cs);
     /**
      * @brief Set Road Parameters.
      * @details Set all states with the parameters found with Genetic Algorithm, for road tracks.
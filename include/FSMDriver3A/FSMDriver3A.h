@@ -20,6 +20,7 @@
 #include "Stuck.h"
 #include "FSMDriver.h"
 #include "Knowledge.h"
+#include "ThreeStateFSM.h"
 
 /** @class FSMDriver3A
 *   @brief The driver itself with improved acceleration performance.
@@ -40,21 +41,6 @@ private:
     Stuck stuck;
 
 public:
-    /** Called when the driver finishes the race. */
-    virtual void onShutdown();
-    /** Called when TORCS asks a race restart. */
-    virtual void onRestart();
-
-    /**
-     * @brief init angles of range finders.
-     * @details In order to maximize the efficiency of the information received from
-     * the track, the vector of sensors in the Three-State FSM was initialized
-     * according to a normal distribution, i.e., the sensors are more
-     * densely distributed in front of car and less on the sides.
-     * 
-     * @param angles values in degrees of the range finders.*/
-    virtual void init(float *angles);
-
     /** Empty constructor. */
     FSMDriver3A();
 
@@ -67,7 +53,7 @@ public:
     *   The transition check if the car is stuck by the it's speed, if it is lower than certain value for long enough it is stuck, if it is not, the function check the car is inside or
     *   out side the track using tracks sensors than choosing the appropriate state.
     *	@param cs a data structure cointaining information from the car's sensors.*/
-    void transition(CarState &cs);
+    void transition(const CarState &cs);
 
     /**
      * @brief Set Road Parameters.
@@ -0,0 +1,85 @@
+/**  @file: FSMDriver3S.h
+ *
+ * https://github.com/bruno147/fsmdriver
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. 
+ */
+
+#ifndef UNB_FSMDRIVER_FSMDRIVER3S_H
+#define UNB_FSMDRIVER_FSMDRIVER3S_H
+
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#include "InsideTrack.h"
+#include "OutOfTrack.h"
+#include "Stuck.h"
+#include "FSMDriver.h"
+#include "StaticFSM.h"
+#include "ThreeStateFSM.h"
+#include "TransitionTable.h"
+#include "Knowledge.h"
+
+/** @class FSMDriver3S
+*   @brief The driver itself.
+*
+*   This class defines the driver based on a FSM.
+*
+*   It drives exactly as FSMDriver3, with its states in a StaticFSM: the
+*   current state's drive is an inlined visit, with no virtual calls. The
+*   parameters and the transitions are those of FSMDriver3 (see
+*   ThreeStateFSM.h); its table names the states by their position in fsm.
+*
+*   Please note that this documentation provide information about the espefic files of the newFSM driver,
+*   the Loiacono's files(at src and include folder) have not been documented by us, for that reason the
+*   Doxygen does not generate these files documentation, more information can be found at the own comments
+*   of the code.
+*/
+
+class FSMDriver3S : public FSMDriver {
+private:
+    // States.
+    StaticFSM<InsideTrack, OutOfTrack, Stuck> fsm;
+
+    /** The transitions between the states, compiled by the constructor. */
+    TransitionTable<FSMDriver3S, unsigned int> transitions;
+
+public:
+    /** The stuck state, for the transitions. */
+    Stuck &stuckState() { return fsm.get<Stuck>(); }
+
+    /** Empty constructor. */
+    FSMDriver3S();
+    /** Empty destructor */
+    virtual ~FSMDriver3S();
+    /** Transitions between states. */
+    /**
+    *   This method decides whenever the current state does not fit with the car status and needs to be changed.The transition choose the most fitted state at the moment of the race.
+    *   The transition check if the car is stuck by the it's speed, if it is lower than certain value for long enough it is stuck, if it is not, the function check the car is inside or
+    *   out side the track using tracks sensors than choosing the appropriate state.
+    *   The choice is made by the TransitionTable of FSMDriver3, which calls each of these checks once.
+    *	@param cs a data structure cointaining information from the car's sensors.
+    */
+    void transition(const CarState &cs);
+    /**
+     * @brief Set Road Parameters.
+     * @details Set all states with the parameters found with Genetic Algorithm, for road tracks.
+     */
+    void setROAD();
+    /**
+     * @brief Set Dirt Parameters.
+     * @details Set all states with the parameters found with Genetic Algorithm, for dirt tracks.
+     */
+    void setDIRT();
+
+    /** The drive, fallback and name of the current state of fsm. */
+    CarControl stateDrive(const CarState &cs);
+    CarControl stateFallback(const CarControl &last) const;
+    const char *stateName() const;
+};
+
+#endif // FSMDriver3S_H
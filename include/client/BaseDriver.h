@@ -17,6 +17,8 @@
 #define BASEDRIVER_H_
 
 #include<iostream>
+#include<cstring>
+#include "LatencyStats.h"
 
 using namespace std;
 
@@ -29,13 +31,27 @@ public:
 	tstage stage;
 	char trackName[100];
 
+	// Timings of the control ticks, recorded by the client and the driver
+	LatencyStats latency;
+
+	// Whether the driver picks up edits of the files it reads at init (such
+	// as a track profile) while racing, without reading them every tick
+	bool watchFiles;
+
+	// Whether the driver writes what it learns (such as the landmarks of a
+	// track, or its surface) to files; the replay tool turns it off, so a
+	// replay neither changes them nor depends on an earlier one
+	bool saveFiles;
+
 	// Default Constructor
-	BaseDriver(){};
+	BaseDriver() : watchFiles(false), saveFiles(true) {};
 
 	// Default Destructor;
 	virtual ~BaseDriver(){};
 	
-	// Initialization of the desired angles for the rangefinders
+	// Initialization of the desired angles for the rangefinders, called once
+	// before the first identification (the driver keeps its state through
+	// restarts)
 	virtual void init(float *angles){
 		for (int i = 0; i < 19; ++i)
 			angles[i]=-90+i*10;
@@ -46,6 +62,32 @@ public:
 	//     - it returns a string representing the controlling action to perform    
 	virtual string drive(string sensors)=0;
 
+	// Allocation free variant of drive, used by the client on every tick:
+	//     - sensors is a view of the received message (len bytes, it does not
+	//       need to be '\0' terminated) and is not kept after the call
+	//     - the action is written into the caller buffer (size bytes, text
+	//       actions are '\0' terminated) and its length is returned, or -1 if
+	//       it does not fit
+	// The default implementation is a shim over the string version.
+	virtual int drive(const char *sensors, size_t len, char *action, size_t size)
+	{
+		string str = drive(string(sensors, len));
+		if (str.length() >= size)
+			return -1;
+		memcpy(action, str.c_str(), str.length()+1);
+		return str.length();
+	};
+
+	// Cheap action to send instead of the next one if that one is late:
+	// written like the action of drive, it returns its length or -1 if the
+	// driver has none (then its last action is repeated). Called right after
+	// drive, see DeadlineDriver.
+	virtual int fallback(char *action, size_t size){ return -1; };
+
+	// Writes the driver's record of its last ticks to path, to look into
+	// its decisions; false if it keeps none or cannot write it
+	virtual bool dumpTrace(const char *path){ return false; };
+
 	// Callback function called at shutdown
 	virtual void onShutdown(){};
 	
@@ -0,0 +1,59 @@
+/***************************************************************************
+
+    file                 : BinaryParser.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef BINARYPARSER_H_
+#define BINARYPARSER_H_
+
+#include <cstring>
+#include "MessageSchema.h"
+
+// Fixed layout binary encoding of the SCR messages, an optional alternative
+// to the text S-expressions:
+//     - a 4 byte header: BINARY_MAGIC, 'B', BINARY_VERSION and the kind of
+//       message (BINARY_SENSORS or BINARY_ACTION)
+//     - every value of every schema field, in schema order, as a 4 byte
+//       little-endian IEEE float or two's complement int
+// Control strings (***identified***, ***restart***, ...) stay in text.
+class BinaryParser
+{
+public:
+        static const unsigned char BINARY_MAGIC   = 0xFB;
+        static const unsigned char BINARY_VERSION = 1;
+        static const unsigned char BINARY_SENSORS = 'S';
+        static const unsigned char BINARY_ACTION  = 'A';
+
+        static const size_t HEADER_LEN = 4;
+
+        // Group appended to the init string to ask for the binary encoding,
+        // and echoed after ***identified*** by a server that accepts it.
+        static const char *WIRE_GROUP;
+
+        // Size of the encoding of a message described by schema
+        static size_t length(const MessageSchema &schema);
+
+        // Whether buf holds a binary message of the given kind
+        static bool  isBinary(const char *buf, size_t len, unsigned char kind);
+
+        // Writes object as a binary message of the given kind; returns its
+        // length or -1 if it does not fit in size bytes.
+        static int   encode(const MessageSchema &schema, const void *object, unsigned char kind,
+                            char *buf, size_t size);
+
+        // Reads a binary message of the given kind into object; false if buf
+        // is not one or is too short.
+        static bool  decode(const MessageSchema &schema, void *object, unsigned char kind,
+                            const char *buf, size_t len);
+};
+
+#endif /*BINARYPARSER_H_*/
@@ -21,6 +21,7 @@
 #include <cstring>
 #include <cassert>
 #include "SimpleParser.h"
+#include "BinaryParser.h"
 
 using namespace std;
 
@@ -60,23 +61,43 @@ public:
 
         string toString();
 
+        // Writes the action message into buf (at most size bytes, '\0'
+        // terminated) without allocating; returns its length or -1 if the
+        // message does not fit.
+        int toString(char *buf, size_t size) const;
+
+        // Longest message toString(char*, size_t) can produce
+        static const size_t MAX_MSG_LEN = 7*(8 + SimpleParser::MAX_NUMBER_LEN + 2) + 1;
+
+        // Layout of the action message, shared by toString and fromString
+        static const MessageField FIELDS[];
+
+        static const MessageSchema SCHEMA;
+
         void fromString(string sensors);
 
+        // Binary encoding of the action (see BinaryParser): toBinary returns
+        // the length written or -1 if it does not fit, fromBinary false if
+        // buf does not hold a binary action.
+        int toBinary(char *buf, size_t size) const;
+
+        bool fromBinary(const char *buf, size_t len);
+
         /* Getter and setter methods */
 
-        float getAccel() const;
+        float getAccel() const { return this->accel; };
         
         void setAccel (float accel);
         
-        float getBrake() const;
+        float getBrake() const { return this->brake; };
         
         void setBrake (float brake);
         
-        int getGear() const;
+        int getGear() const { return this->gear; };
         
         void setGear(int gear);
         
-        float getSteer() const;
+        float getSteer() const { return this->steer; };
         
         void setSteer(float steer);  
         
@@ -84,7 +105,7 @@ public:
         
         void setMeta(int gear);
 
-        float getClutch() const;
+        float getClutch() const { return clutch; };
 
         void setClutch(float clutch);
 
@@ -0,0 +1,125 @@
+/***************************************************************************
+
+    file                 : CarSession.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef CARSESSION_H_
+#define CARSESSION_H_
+
+#include "BaseDriver.h"
+#include "DeadlineDriver.h"
+#include "SessionLog.h"
+
+// The client side of the SCR protocol for one car, independent of how the
+// messages are sent and received: identification, episodes (restarts),
+// step limits and the shutdown of the driver. The caller owns the socket,
+// sends identification() while the session is IDENTIFYING and passes every
+// message from the server to receive().
+class CarSession
+{
+public:
+
+	typedef enum{IDENTIFYING,DRIVING,FINISHED} tstatus;
+
+	// Number of consecutive timeouts after which the server is given up
+	static const int MAX_SILENCE = 10;
+
+	// Longest action a driver may compute with a budget
+	static const size_t MAX_ACTION_LEN = 1000;
+
+	CarSession(BaseDriver &driver, const char *id, unsigned int maxEpisodes,
+	           unsigned int maxSteps, bool binaryWire = false);
+	~CarSession();
+
+	// Gives the driver budget microseconds to compute each action, sending
+	// its fallback when it takes longer (see DeadlineDriver); 0 waits for
+	// it, as by default.
+	void setBudget(long budget);
+
+	// Records every message the driver handles, with the actions it sends
+	// back, to a session log at path (see SessionLog.h); false if the file
+	// cannot be created.
+	bool record(const char *path);
+
+	// Writes the identification message (id and init string) into buf and
+	// returns its length, or -1 if it does not fit in size bytes. The driver
+	// is initialized and the message built only once: retries and later
+	// episodes resend it, and the driver keeps its state between episodes.
+	int identification(char *buf, size_t size);
+
+	// Handles a message from the server (msg[len] must be '\0'). Returns
+	// the number of bytes of reply to send back (0 if there is none, -1 if
+	// the action did not fit in size bytes).
+	int receive(const char *msg, size_t len, char *reply, size_t size);
+
+	// Whether msg is sensors the driver would be asked to act on, rather
+	// than a message of the protocol itself (identification, restart or
+	// shutdown), which must never be dropped.
+	bool isSensors(const char *msg) const;
+
+	// Skips sensors that are stale because newer ones already arrived: the
+	// driver does not see them, but they show the server is alive.
+	void drop();
+
+	// The server did not send anything for the client timeout.
+	void timeout();
+
+	// Ends the session, shutting the driver down unless that is done (which
+	// prints its tick latencies).
+	void finish();
+
+	tstatus getStatus() const { return status; };
+
+	// Whether actions are sent in the binary encoding
+	bool isBinary() const { return binaryWire; };
+
+	// Actions computed by the driver, over all episodes
+	unsigned long getSteps() const { return steps; };
+
+	// Sensors skipped with drop(), over all episodes
+	unsigned long getDropped() const { return dropped; };
+
+	// Prints the tick latencies of the driver, with a budget how many ticks
+	// overran it, and how many stale sensors were dropped.
+	void printStats(ostream &out);
+
+	BaseDriver &driver;
+
+private:
+	const char *id;
+	unsigned int maxEpisodes;
+	unsigned int maxSteps;
+	bool wantBinary;
+	bool binaryWire;
+
+	tstatus status;
+	unsigned long curEpisode;
+	unsigned long currentStep;
+	unsigned long steps;
+	unsigned long dropped;
+	int silence;
+	bool shutdownClient;
+	DeadlineDriver *deadline;
+	SessionRecorder recorder;
+	string init;
+	long long restartedAt;
+
+	CarSession(const CarSession &);
+	CarSession &operator=(const CarSession &);
+
+	void endEpisode();
+
+	// Calls the driver's onShutdown and prints its tick latencies
+	void shutdownDriver();
+};
+
+#endif /*CARSESSION_H_*/
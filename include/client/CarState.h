@@ -25,121 +25,324 @@
 #include <cstring>
 #include <cassert>
 #include "SimpleParser.h"
+#include "BinaryParser.h"
 
 using namespace std;
 
 class CarState
 {
 
+public:
+        // Number of groups in the sensor message
+        static const int FIELDS_NUM = 19;
+
+        // Position of each group in FIELDS (checked in CarState.cpp)
+        typedef enum {ANGLE, CUR_LAP_TIME, DAMAGE, DIST_FROM_START, DIST_RACED, FOCUS, FUEL, GEAR, LAST_LAP_TIME, OPPONENTS, RACE_POS, RPM, SPEED_X, SPEED_Y, SPEED_Z, TRACK, TRACK_POS, WHEEL_SPIN_VEL, Z} tfield;
+
 private:
-        float angle;
-        float curLapTime;
-        float damage;
-        float distFromStart;
-        float distRaced;
-        float focus[FOCUS_SENSORS_NUM];
-        float fuel;
-        int   gear;
-        float lastLapTime;
-        float opponents[OPPONENTS_SENSORS_NUM];
-        int   racePos;
-        int   rpm;
-        float speedX;
-        float speedY;
-        float speedZ;
-        float track[TRACK_SENSORS_NUM];
-        float trackPos;
-        float wheelSpinVel[4];
-        float z;
-        
+        // The values. They are mutable as the lazy decoding fills them in on
+        // first read, from the const getters (see decode).
+        mutable float angle;
+        mutable float curLapTime;
+        mutable float damage;
+        mutable float distFromStart;
+        mutable float distRaced;
+        mutable float focus[FOCUS_SENSORS_NUM];
+        mutable float fuel;
+        mutable int   gear;
+        mutable float lastLapTime;
+        mutable float opponents[OPPONENTS_SENSORS_NUM];
+        mutable int   racePos;
+        mutable int   rpm;
+        mutable float speedX;
+        mutable float speedY;
+        mutable float speedZ;
+        mutable float track[TRACK_SENSORS_NUM];
+        mutable float trackPos;
+        mutable float wheelSpinVel[4];
+        mutable float z;
+
+        // Lazy decoding: the message the fields are read from on first use,
+        // where the values of each field lie in it and which fields are
+        // still to be decoded (bit i for FIELDS[i]).
+        const char *source;
+        unsigned short valueBegin[FIELDS_NUM];
+        unsigned short valueEnd[FIELDS_NUM];
+        mutable unsigned long pending;
+
+        void decode(int i) const;
+
+        void fetch(int i) const
+        {
+#ifdef __CARSTATE_ACCESS_STATS__
+                ++reads[i];
+#endif
+                if (pending & (1ul << i))
+                        decode(i);
+        };
+
+        void fetchAll() const;
+
+#ifdef __CARSTATE_ACCESS_STATS__
+        mutable unsigned int reads[FIELDS_NUM];
+#endif
+
 
 public:
 	
-		CarState(){};
+		CarState() : source(NULL), pending(0) {};
 
-        CarState(string sensors);
+        CarState(const string &sensors);
+
+        // With lazy set the message is only indexed here and each field is
+        // decoded the first time it is read, so sensors must stay valid (and
+        // unchanged) while the state is in use. Binary messages (see
+        // BinaryParser) are recognized and always decoded at once.
+        CarState(const char *sensors, size_t len, bool lazy = false);
 
         string toString();
 
+        // Writes the binary encoding of the state into buf; returns its
+        // length or -1 if it does not fit in size bytes.
+        int toBinary(char *buf, size_t size);
+
+        // Layout of the sensor message: the single description of its tags,
+        // array sizes and storage, used both to parse and to write it.
+        static const MessageField FIELDS[];
+
+        static const MessageSchema SCHEMA;
+
+        // Longest message toString can produce
+        static const size_t MAX_MSG_LEN;
+
+        // Longest message that can be decoded lazily
+        static const size_t MAX_LAZY_MSG_LEN = 65535;
+
+#ifdef __CARSTATE_ACCESS_STATS__
+        // Number of reads of FIELDS[field] since the state was built
+        unsigned int getReads(int field) const;
+
+        void clearReads() const;
+#endif
+
         /* Getter and setter methods */
         
-        float getAngle();
+        float getAngle() const;
         
         void setAngle(float angle);
         
-        float getCurLapTime();
+        float getCurLapTime() const;
         
         void setCurLapTime(float curLapTime);
         
-        float getDamage();
+        float getDamage() const;
         
         void setDamage(float damage);
         
-        float getDistFromStart();
+        float getDistFromStart() const;
         
         void setDistFromStart(float distFromStart);
         
-        float getDistRaced();
+        float getDistRaced() const;
         
         void setDistRaced(float distRaced);
 
-        float getFocus(int i);
+        float getFocus(int i) const;
 
         void setFocus(int i, float value);
 
-        float getFuel();
+        float getFuel() const;
         
         void setFuel(float fuel);
         
-        int getGear();
+        int getGear() const;
         
         void setGear(int gear);
         
-        float getLastLapTime();
+        float getLastLapTime() const;
         
         void setLastLapTime(float lastLapTime);
         
-        float getOpponents(int i);
+        float getOpponents(int i) const;
         
         void setOpponents(int i, float value);
         
-        int getRacePos();
+        int getRacePos() const;
         
         void setRacePos(int racePos);
         
-        int getRpm();
+        int getRpm() const;
         
         void setRpm(int rpm);
         
-        float getSpeedX();
+        float getSpeedX() const;
         
         void setSpeedX(float speedX);
         
-        float getSpeedY();
+        float getSpeedY() const;
         
         void setSpeedY(float speedY);
         
-        float getSpeedZ();
+        float getSpeedZ() const;
 
         void setSpeedZ(float speedZ);
 
-        float getTrack(int i);
+        float getTrack(int i) const;
         
         void setTrack(int i, float value);
         
-        float getTrackPos();
+        float getTrackPos() const;
         
         void setTrackPos(float trackPos);
         
-        float getWheelSpinVel(int i);
+        float getWheelSpinVel(int i) const;
         
         void setWheelSpinVel(int i, float value);
 
-        float getZ();
+        float getZ() const;
 
         void setZ(float z);
 
 
 };
 
+// The getters are read on every tick, so they are inlined
+inline float
+CarState::getAngle() const
+{
+        fetch(ANGLE);
+        return angle;
+}
+
+inline float
+CarState::getCurLapTime() const
+{
+        fetch(CUR_LAP_TIME);
+        return curLapTime;
+}
+
+inline float
+CarState::getDamage() const
+{
+        fetch(DAMAGE);
+        return damage;
+}
+
+inline float
+CarState::getDistFromStart() const
+{
+        fetch(DIST_FROM_START);
+        return distFromStart;
+}
+
+inline float
+CarState::getDistRaced() const
+{
+        fetch(DIST_RACED);
+        return distRaced;
+}
+
+inline float
+CarState::getFocus(int i) const
+{
+        fetch(FOCUS);
+        assert(i>=0 && i<FOCUS_SENSORS_NUM);
+        return focus[i];
+}
+
+inline float
+CarState::getFuel() const
+{
+        fetch(FUEL);
+        return fuel;
+}
+
+inline int
+CarState::getGear() const
+{
+        fetch(GEAR);
+        return gear;
+}
+
+inline float
+CarState::getLastLapTime() const
+{
+        fetch(LAST_LAP_TIME);
+        return lastLapTime;
+}
+
+inline float
+CarState::getOpponents(int i) const
+{
+        fetch(OPPONENTS);
+        assert(i>=0 && i<OPPONENTS_SENSORS_NUM);
+        return opponents[i];
+        
+}
+
+inline int
+CarState::getRacePos() const
+{
+        fetch(RACE_POS);
+        return racePos;
+}
+
+inline int
+CarState::getRpm() const
+{
+        fetch(RPM);
+        return rpm;
+}
+
+inline float
+CarState::getSpeedX() const
+{
+        fetch(SPEED_X);
+        return speedX;
+}
+
+inline float
+CarState::getSpeedY() const
+{
+        fetch(SPEED_Y);
+        return speedY;
+}
+
+inline float
+CarState::getSpeedZ() const
+{
+        fetch(SPEED_Z);
+        return speedZ;
+}
+
+inline float
+CarState::getTrack(int i) const
+{
+        fetch(TRACK);
+        assert(i>=0 && i<TRACK_SENSORS_NUM);
+        return track[i];
+}
+
+inline float
+CarState::getTrackPos() const
+{
+        fetch(TRACK_POS);
+        return trackPos;
+}
+
+inline float
+CarState::getWheelSpinVel(int i) const
+{
+        fetch(WHEEL_SPIN_VEL);
+        assert(i>=0 && i<4);
+	return wheelSpinVel[i];
+}
+
+inline float
+CarState::getZ() const
+{
+        fetch(Z);
+        return z;
+}
+
 #endif /*CARSTATE_H_*/
@@ -0,0 +1,81 @@
+/***************************************************************************
+
+    file                 : DeadlineDriver.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef DEADLINEDRIVER_H_
+#define DEADLINEDRIVER_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BaseDriver.h"
+
+// Runs a driver with a compute budget per tick. The driver computes on a
+// worker thread; if it does not answer within the budget, drive returns
+// the driver's precomputed fallback (see BaseDriver::fallback), or the
+// last action, and the late action is discarded. Ticks that arrive while
+// the driver is still busy with a late one are answered with the fallback
+// as well.
+class DeadlineDriver
+{
+public:
+
+	// budget in microseconds; actions are at most size bytes
+	DeadlineDriver(BaseDriver &driver, long budget, size_t size);
+	~DeadlineDriver();
+
+	// Same contract as BaseDriver::drive.
+	int drive(const char *sensors, size_t len, char *action, size_t size);
+
+	// Waits for the driver to finish the tick it is computing, so it can be
+	// called (onRestart, onShutdown) or inspected from the caller thread.
+	void sync();
+
+	long getBudget() const { return budget; };
+
+	// Ticks computed by the driver
+	unsigned long getTicks() const { return ticks; };
+
+	// Ticks the driver took longer than the budget to compute
+	unsigned long getOverruns() const { return overruns; };
+
+	// Ticks answered with the fallback without asking the driver, because
+	// it was still computing a late one
+	unsigned long getSkipped() const { return skipped; };
+
+	// Ticks answered with the fallback (overruns plus skipped ones)
+	unsigned long getFallbacks() const { return fallbacks; };
+
+private:
+	BaseDriver &driver;
+	long budget;
+
+	mutex lock;
+	condition_variable requested, answered;
+	thread worker;
+	bool busy, stop;
+
+	vector<char> sensors, action, fallback;
+	size_t sensorsLen;
+	int actionLen, fallbackLen;
+
+	unsigned long ticks, overruns, skipped, fallbacks;
+
+	void work();
+
+	// Copies the fallback into buf (with the lock held); -1 if there is none
+	int sendFallback(char *buf, size_t size);
+};
+
+#endif /*DEADLINEDRIVER_H_*/
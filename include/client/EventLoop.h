@@ -0,0 +1,81 @@
+/***************************************************************************
+
+    file                 : EventLoop.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef EVENTLOOP_H_
+#define EVENTLOOP_H_
+
+#include <vector>
+
+using namespace std;
+
+// Waits on any number of sockets, deadlines and signals at once. On Linux it is built on epoll, with one timerfd per deadline and a
+// signalfd; elsewhere it falls back to select.
+//
+// Sockets are edge-triggered: after a READABLE event the caller must read
+// until the socket has nothing left (EAGAIN), as nothing more is reported
+// for the data already queued.
+class EventLoop
+{
+public:
+
+	typedef enum{READABLE,TIMEOUT,SIGNALED} tkind;
+
+	typedef struct
+	{
+		tkind kind;
+		int id;     // the id given to watch or addTimer, or the signal number
+	} tevent;
+
+	EventLoop();
+	~EventLoop();
+
+	// Whether the loop could be set up
+	bool isValid() const;
+
+	// Reports incoming data on fd as READABLE events with the given id. The
+	// socket is made non blocking.
+	bool watch(int fd, int id);
+
+	// Adds a one-shot deadline reported as TIMEOUT events with the given id
+	// (ids are small non negative numbers, such as a car index).
+	bool addTimer(int id);
+
+	// (Re)arms the deadline id to expire usec microseconds from now; 0
+	// disarms it.
+	void arm(int id, long usec);
+
+	// Reports SIGINT, SIGTERM and (where it exists) SIGUSR1 as SIGNALED
+	// events instead of letting them kill the process.
+	bool catchSignals();
+
+	// Makes wait poll without blocking for up to usec microseconds before
+	// it blocks, trading CPU for wakeup latency (Linux only; 0 disables it).
+	void setSpin(long usec) { spin = usec; };
+
+	// Blocks until something happens and stores up to max events; returns
+	// how many, or -1 on error.
+	int wait(tevent *events, int max);
+
+private:
+	long spin;
+	int epollFd;
+	int signalFd;
+	vector<int> timerFds;
+
+	// select fallback
+	vector<int> fds, fdIds;
+	vector<long long> deadlines;
+};
+
+#endif /*EVENTLOOP_H_*/
@@ -0,0 +1,119 @@
+/***************************************************************************
+
+    file                 : LatencyStats.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef LATENCYSTATS_H_
+#define LATENCYSTATS_H_
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+// Histogram of durations in ns with log sized buckets (HDR style): values
+// below SUB_BUCKETS are exact, then every power of two is split in
+// SUB_BUCKETS buckets, so any value is known within 1/SUB_BUCKETS of it.
+// Recording is a couple of integer operations and never allocates.
+class LatencyHistogram
+{
+public:
+
+	static const int SUB_BUCKETS = 16;
+	static const int BUCKETS_NUM = 61*SUB_BUCKETS;
+
+	LatencyHistogram() { clear(); };
+
+	void record(long long ns)
+	{
+		if (ns < 0)
+			ns = 0;
+		counts[bucket(ns)]++;
+		total++;
+		sum += ns;
+		if (ns > maxValue)
+			maxValue = ns;
+	};
+
+	void clear();
+
+	// Adds the values recorded in other
+	void add(const LatencyHistogram &other);
+
+	unsigned long count() const { return total; };
+
+	long long max() const { return maxValue; };
+
+	long long mean() const { return total ? sum / total : 0; };
+
+	// Upper bound of the bucket holding the given fraction (0 to 1) of
+	// the values, or 0 if there are none.
+	long long percentile(double fraction) const;
+
+private:
+	unsigned long counts[BUCKETS_NUM];
+	unsigned long total;
+	long long sum;
+	long long maxValue;
+
+	static int bucket(long long ns)
+	{
+		if (ns < SUB_BUCKETS)
+			return ns;
+		int octave = 63 - __builtin_clzll(ns);  // >= 4
+		return (octave-3)*SUB_BUCKETS + ((ns >> (octave-4)) & (SUB_BUCKETS-1));
+	};
+
+	static long long upperBound(int bucket);
+};
+
+// Timings of the phases of a control tick, from the moment the sensors are
+// received to the moment the action is sent. Each layer records its own
+// phases: the client the socket calls, WrapperBaseDriver the parsing and
+// serialization, FSMDriver the transition and the state's drive. With lazy
+// decoding most of the parsing is counted in transition and drive.
+class LatencyStats
+{
+public:
+
+	typedef enum{QUEUE,RECEIVE,PARSE,TRANSITION,DRIVE,SERIALIZE,SEND,TICK,WAKEUP,RESTART,PHASES_NUM} tphase;
+
+	// Names of the phases: QUEUE is the time the message waited in the
+	// socket (only with kernel timestamps), TICK from the return of the
+	// receive to the return of the send and WAKEUP from the moment the
+	// client woke up for the message (or sent the previous one, if it was
+	// already queued) to the return of the send. RESTART goes from a
+	// restart of the race to the first action of the next episode.
+	static const char *PHASE_NAMES[PHASES_NUM];
+
+	// Monotonic clock, in ns
+	static long long now()
+	{
+		return chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+	};
+
+	void record(tphase phase, long long ns) { phases[phase].record(ns); };
+
+	const LatencyHistogram &get(tphase phase) const { return phases[phase]; };
+
+	// Prints a line per phase with samples: count, mean, percentiles and
+	// max, in microseconds.
+	void print(ostream &out) const;
+
+	void clear();
+
+private:
+	LatencyHistogram phases[PHASES_NUM];
+};
+
+#endif /*LATENCYSTATS_H_*/
@@ -0,0 +1,57 @@
+/***************************************************************************
+
+    file                 : LowLatency.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef LOWLATENCY_H_
+#define LOWLATENCY_H_
+
+#include <iostream>
+
+using namespace std;
+
+// Runtime settings that trade CPU for wakeup latency, given to the client
+// as lowlatency:<cpu>[,fifo[=priority]][,spin=<us>]:
+//     - the control thread (and the threads it starts later) is pinned to
+//       the given core (-1 leaves it alone)
+//     - fifo asks for the SCHED_FIFO real-time policy
+//     - all the memory of the process is locked (mlockall)
+//     - the client spins up to spin microseconds polling for the next
+//       message before blocking, and the socket is set to busy poll
+//       (SO_BUSY_POLL) for as long
+// Settings the system refuses are reported and skipped. Linux only.
+class LowLatency
+{
+public:
+
+	static const long DEFAULT_SPIN = 200;
+	static const int DEFAULT_FIFO_PRIORITY = 50;
+
+	LowLatency() : enabled(false), cpu(-1), fifoPriority(0), spin(0) {};
+
+	bool enabled;
+	int cpu;
+	int fifoPriority;   // 0 keeps the default policy
+	long spin;          // microseconds
+
+	// Reads the value of the lowlatency: option; false if it is malformed.
+	bool parse(const char *value);
+
+	// Applies the settings to the calling thread, the process and socket
+	// (socket < 0 skips the socket settings); false if any was refused.
+	bool apply(int socket, ostream &log) const;
+
+	// Describes the settings
+	void print(ostream &out) const;
+};
+
+#endif /*LOWLATENCY_H_*/
@@ -0,0 +1,141 @@
+/***************************************************************************
+
+    file                 : MessageSchema.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef MESSAGESCHEMA_H_
+#define MESSAGESCHEMA_H_
+
+#include <cstddef>
+#include <cstring>
+
+// Number of slots of a schema's tag lookup table (a power of 2)
+#define SCHEMA_SLOTS 64
+
+// Type of the values of a message field
+enum FieldType { FIELD_FLOAT, FIELD_INT };
+
+// One "(tag values...)" group of a SCR message: its tag, where its values
+// are stored in the wrapper object, their type and how many there are
+// (FIELD_INT fields are scalars).
+struct MessageField
+{
+	const char *tag;
+	size_t      tagLen;
+	size_t      offset;
+	FieldType   type;
+	int         arity;
+};
+
+// Hash of a tag into a lookup table slot. It only looks at the first and
+// last characters and the length, which is enough to tell all the SCR tags
+// apart (each schema checks it at compile time).
+constexpr unsigned
+schemaHash(const char *tag, size_t len)
+{
+	return ((unsigned char) tag[0] ^ (unsigned char) tag[len-1] ^ (unsigned) len*13) & (SCHEMA_SLOTS-1);
+}
+
+// Index of the field of fields[i..n) that hashes to slot, or -1
+constexpr int
+schemaSlotOwner(const MessageField *fields, int n, unsigned slot, int i = 0)
+{
+	return i == n ? -1
+	     : schemaHash(fields[i].tag, fields[i].tagLen) == slot ? i
+	     : schemaSlotOwner(fields, n, slot, i + 1);
+}
+
+constexpr bool
+schemaTagIs(const char *tag, const char *name)
+{
+	return *tag == *name && (*tag == '\0' || schemaTagIs(tag + 1, name + 1));
+}
+
+// Index of the field of fields[i..n) named tag, or -1
+constexpr int
+schemaIndex(const MessageField *fields, int n, const char *tag, int i = 0)
+{
+	return i == n ? -1
+	     : schemaTagIs(fields[i].tag, tag) ? i
+	     : schemaIndex(fields, n, tag, i + 1);
+}
+
+// Whether no two fields of fields[i..n) share a slot
+constexpr bool
+schemaIsPerfect(const MessageField *fields, int n, int i = 0)
+{
+	return i == n ? true
+	     : schemaSlotOwner(fields, n, schemaHash(fields[i].tag, fields[i].tagLen)) == i
+	       && schemaIsPerfect(fields, n, i + 1);
+}
+
+// Longest message the fields of fields[i..n) can be written to, when each
+// number takes at most numberLen chars (including the terminating '\0')
+constexpr size_t
+schemaMaxLength(const MessageField *fields, int n, size_t numberLen, int i = 0)
+{
+	return i == n ? 1
+	     : 1 + fields[i].tagLen + fields[i].arity*(1 + numberLen) + 1
+	       + schemaMaxLength(fields, n, numberLen, i + 1);
+}
+
+// A complete schema: its fields in message order and the perfect hash table
+// from tag to field index (-1 for free slots).
+struct MessageSchema
+{
+	const MessageField *fields;
+	int                 size;
+	const signed char  *slots;
+
+	// Index of the field with the given tag, or -1 (a single table probe).
+	int find(const char *tag, size_t len) const
+	{
+		if (len == 0)
+			return -1;
+		int i = slots[schemaHash(tag, len)];
+		if (i < 0 || fields[i].tagLen != len || memcmp(fields[i].tag, tag, len) != 0)
+			return -1;
+		return i;
+	}
+};
+
+template<int... S> struct SchemaSlotSeq {};
+
+template<int N, int... S>
+struct MakeSchemaSlotSeq : MakeSchemaSlotSeq<N-1, N-1, S...> {};
+
+template<int... S>
+struct MakeSchemaSlotSeq<0, S...>
+{
+	typedef SchemaSlotSeq<S...> type;
+};
+
+// Lookup table of the N fields at Fields, filled in at compile time.
+template<const MessageField *Fields, int N,
+         typename Seq = typename MakeSchemaSlotSeq<SCHEMA_SLOTS>::type>
+struct SchemaTable;
+
+template<const MessageField *Fields, int N, int... S>
+struct SchemaTable<Fields, N, SchemaSlotSeq<S...> >
+{
+	static_assert(schemaIsPerfect(Fields, N), "two tags share a schemaHash slot");
+
+	static constexpr signed char slots[SCHEMA_SLOTS] = { (signed char) schemaSlotOwner(Fields, N, S)... };
+};
+
+template<const MessageField *Fields, int N, int... S>
+constexpr signed char SchemaTable<Fields, N, SchemaSlotSeq<S...> >::slots[SCHEMA_SLOTS];
+
+// Declares a schema field for member m of class C
+#define SCHEMA_FIELD(C, m, type, arity) { #m, sizeof(#m) - 1, offsetof(C, m), type, arity }
+
+#endif /*MESSAGESCHEMA_H_*/
@@ -0,0 +1,101 @@
+/***************************************************************************
+
+    file                 : SessionLog.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef SESSIONLOG_H_
+#define SESSIONLOG_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Append-only log of a client session, to replay it offline (see
+// src/tools/replay.cpp). The file starts with MAGIC and is followed by
+// records of:
+//     - a 1 byte type (one of the tlogtype values)
+//     - the length of the payload, 4 bytes
+//     - the time since the log was opened in ns, 8 bytes
+//     - the payload: the message exactly as it was received or sent
+// Numbers are little-endian. The first record is a HEADER whose payload
+// holds the client arguments the driver depends on, as "id:<id>
+// track:<name> stage:<n>".
+class SessionLog
+{
+public:
+
+	typedef enum{HEADER='H', SENSORS='S', ACTION='A', RESTART='R', SHUTDOWN='X'} tlogtype;
+
+	static const char MAGIC[8];
+
+	static const size_t RECORD_HEADER_LEN = 13;
+};
+
+// Writes a session log through a large stdio buffer, so recording a tick
+// costs a couple of copies; records reach the file when the buffer fills
+// and on close.
+class SessionRecorder
+{
+public:
+
+	SessionRecorder() : file(NULL), start(0) {};
+	~SessionRecorder() { close(); };
+
+	// Creates path and writes the header; false if it cannot be written.
+	bool open(const char *path, const char *id, const char *trackName, int stage);
+
+	bool isOpen() const { return file != NULL; };
+
+	void record(SessionLog::tlogtype type, const char *data, size_t len);
+
+	void close();
+
+private:
+	FILE *file;
+	long long start;
+	vector<char> buffer;
+
+	SessionRecorder(const SessionRecorder &);
+	SessionRecorder &operator=(const SessionRecorder &);
+};
+
+// Reads a whole session log into memory.
+class SessionReader
+{
+public:
+
+	typedef struct
+	{
+		SessionLog::tlogtype type;
+		long long time;         // ns since the log was opened
+		size_t offset, len;     // payload, in data()
+	} trecord;
+
+	// Loads path; false if it cannot be read or is not a session log (a
+	// truncated last record is dropped).
+	bool load(const char *path);
+
+	// The header fields ("" or 0 if missing)
+	string id, trackName;
+	int stage;
+
+	vector<trecord> records;
+
+	const char *data(const trecord &record) const { return &bytes[record.offset]; };
+
+private:
+	vector<char> bytes;
+};
+
+#endif /*SESSIONLOG_H_*/
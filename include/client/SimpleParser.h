@@ -19,6 +19,7 @@
 #include <iostream>
 #include <sstream>
 #include <cstring>
+#include "MessageSchema.h"
 
 using namespace std;
 
@@ -38,6 +39,56 @@ public:
 
         static string  stringify(string tag, float *value, int size);
 
+        // Single-pass tokenizer: finds the next "(tag values...)" group in
+        // [p,end), sets tag/tagLen and the values range, and moves p past it.
+        static bool  nextGroup(const char *&p, const char *end,
+                               const char *&tag, size_t &tagLen,
+                               const char *&values, const char *&valuesEnd);
+
+        // Number readers working in place on the buffer (no iostreams, no
+        // allocation, locale independent); they advance p past the value.
+        static bool  parseValue(const char *&p, const char *end, float &value);
+
+        static bool  parseValue(const char *&p, const char *end, int &value);
+
+        static bool  parseValues(const char *p, const char *end, float *value, int size);
+
+        // Formatters writing "(tag values...)" straight into buf; they return
+        // the number of chars written (buf is '\0' terminated) or -1 if the
+        // group does not fit in size bytes.
+        static int   stringify(char *buf, size_t size, const char *tag, float value);
+
+        static int   stringify(char *buf, size_t size, const char *tag, int value);
+
+        static int   stringify(char *buf, size_t size, const char *tag, const float *value, int n);
+
+        // Locale independent number formatting with the same output as the
+        // default ostream (6 significant digits); buf needs MAX_NUMBER_LEN.
+        static int   format(char *buf, float value);
+
+        static int   format(char *buf, int value);
+
+        static const int MAX_NUMBER_LEN = 16;
+
+        // Reads every group of the message described by schema into object in
+        // a single pass; returns a bit mask of the fields found (bit i set
+        // for schema.fields[i]).
+        static unsigned long parse(const MessageSchema &schema, void *object, const char *msg, size_t len);
+
+        // Single pass that only records where the values of each field lie
+        // in the message ([msg+begin[i], msg+end[i]) for schema.fields[i]),
+        // so they can be decoded later with parseField. The message must be
+        // shorter than 64KiB. Returns the mask of the fields found.
+        static unsigned long index(const MessageSchema &schema, const char *msg, size_t len,
+                                   unsigned short *begin, unsigned short *end);
+
+        // Reads the values of one schema field from [p,end) into object.
+        static bool  parseField(const MessageField &field, void *object, const char *p, const char *end);
+
+        // Writes all the fields of object, in schema order, into buf; returns
+        // the message length or -1 if it does not fit in size bytes.
+        static int   stringify(const MessageSchema &schema, const void *object, char *buf, size_t size);
+
 };
 
 #endif /*SIMPLEPARSER_H_*/
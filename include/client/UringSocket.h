@@ -0,0 +1,148 @@
+/***************************************************************************
+
+    file                 : UringSocket.h
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef URINGSOCKET_H_
+#define URINGSOCKET_H_
+
+#ifdef __linux__
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+using namespace std;
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf;
+
+// A UDP socket served through an io_uring (Linux 6.0 or later), set up
+// with the raw system calls. A multishot recvmsg stays posted on the
+// socket and fills the buffers of a ring registered with the kernel, so
+// receiving takes no system call. Sends are queued on the submission ring
+// and leave with one io_uring_enter per batch, or with none when a kernel
+// thread polls the ring (sqpoll).
+//
+// Completions are read from memory shared with the kernel. To sleep until
+// there are some, watch getFd() in an EventLoop: it becomes readable when
+// completions are queued, and reap() must then take all of them.
+class UringSocket
+{
+public:
+
+	typedef struct
+	{
+		char *data;                 // '\0' terminated
+		unsigned int len;
+		const struct sockaddr_in *from;
+		long long stamp;            // kernel receive time (CLOCK_REALTIME ns), 0 if none
+		unsigned short buffer;
+	} tmessage;
+
+	// Serves socket with buffers receive buffers (rounded up to a power of
+	// two) for datagrams of up to len bytes. With stamped the kernel
+	// receive time of each datagram is kept, with sqpoll a kernel thread
+	// submits the sends.
+	UringSocket(int socket, unsigned int buffers, size_t len, bool stamped, bool sqpoll);
+	~UringSocket();
+
+	// Whether the ring is set up and receiving
+	bool isValid() const { return valid; };
+
+	// Descriptor of the ring, readable when there are completions
+	int getFd() const { return ringFd; };
+
+	// Most datagrams that can be received and not released
+	unsigned int getBuffers() const { return bufEntries; };
+
+	// Datagrams received and not released yet, oldest first
+	vector<tmessage> received;
+
+	// Takes every queued completion: received datagrams are added to
+	// received and the slots of finished sends are freed. Returns false if
+	// the socket failed.
+	bool reap();
+
+	// Gives the buffers of all the received datagrams back to the kernel
+	// (received is emptied).
+	void release();
+
+	// Queues a copy of the len bytes of data to be sent to to; false if
+	// it does not fit or the ring failed.
+	bool send(const struct sockaddr_in &to, const char *data, size_t len);
+
+	// Submits the queued sends; false on error.
+	bool submit();
+
+	// io_uring_enter calls made, sends that failed and datagrams that did
+	// not fit in a buffer
+	unsigned long getSyscalls() const { return syscalls; };
+	unsigned long getSendErrors() const { return sendErrors; };
+	unsigned long getTruncated() const { return truncated; };
+
+private:
+
+	typedef struct
+	{
+		struct sockaddr_in to;
+		struct iovec iov;
+		struct msghdr hdr;
+	} tslot;
+
+	bool valid;
+	int socket;
+	int ringFd;
+	bool sqpoll;
+	size_t maxLen;
+
+	// submission ring
+	void *sqMem;
+	size_t sqMemLen;
+	unsigned int *sqHead, *sqTail, *sqMask, *sqFlags, *sqArray;
+	struct io_uring_sqe *sqes;
+	size_t sqesLen;
+	unsigned int sqLocalTail;   // entries up to here are published on submit
+
+	// completion ring (in sqMem)
+	unsigned int *cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe *cqes;
+
+	// provided buffers
+	struct io_uring_buf *bufRing;
+	size_t bufRingLen;
+	unsigned int bufEntries;
+	size_t bufLen;
+	vector<char> buffers;
+	struct msghdr recvHdr;
+	bool receiving;
+
+	// sends
+	vector<tslot> slots;
+	vector<char> slotData;
+	vector<unsigned int> freeSlots;
+
+	unsigned long syscalls, sendErrors, truncated;
+
+	struct io_uring_sqe *nextSqe();
+	void postReceive();
+	int enter(unsigned int submit, unsigned int wait, unsigned int flags);
+
+	UringSocket(const UringSocket &);
+	UringSocket &operator=(const UringSocket &);
+};
+
+#endif /*__linux__*/
+
+#endif /*URINGSOCKET_H_*/
@@ -25,12 +25,33 @@
 class WrapperBaseDriver : public BaseDriver
 {
 public:
+
+	WrapperBaseDriver() : lazyState(false), lastBinary(false) {};
+
+	// whether the view based drive decodes each sensor only when the driver
+	// reads it (see CarState)
+	bool lazyState;
 	
 	// the drive function wiht string input and output
 	virtual string drive(string sensors);
+
+	// the drive function on a view of the received message, writing the
+	// action into the caller buffer without any intermediate copy
+	virtual int drive(const char *sensors, size_t len, char *action, size_t size);
 	
 	// drive function that exploits the CarState and CarControl wrappers as input and output.
-	virtual CarControl wDrive(CarState cs)=0;
+	virtual CarControl wDrive(const CarState &cs)=0;
+
+	// the fallback of fallbackControl, in the encoding of the last sensors
+	virtual int fallback(char *action, size_t size);
+
+	// cheap action to send if the next wDrive is late, given the last one
+	// (which is the default)
+	virtual CarControl fallbackControl(const CarControl &last) { return last; };
+
+private:
+	CarControl lastControl;
+	bool lastBinary;
 };
 
 #endif /*WRAPPERBASEDRIVER_H_*/
@@ -29,12 +29,22 @@ DrivingState::exit() {
 	/* Nothing. */
 }
 
+CarControl
+DrivingState::fallback(const CarControl &last) const {
+	return last;
+}
+
+const char *
+DrivingState::name() const {
+	return "DrivingState";
+}
+
 
 /**************************************************************************
  * Modularização*/
 
 CarControl
-DrivingState::drive(CarState &cs) {
+DrivingState::drive(const CarState &cs) {
     float steer = get_steer(cs);
     int gear = get_gear(cs);
     float accel  = get_accel(cs);
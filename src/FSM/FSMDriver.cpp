@@ -9,12 +9,57 @@
  */
 
 #include "FSMDriver.h"
+
+/******************************************************************************/
+#define NUM_SENSORS 19
+/******************************************************************************/
+
+static int signum(float n) {
+    if (n < 0) return -1;
+    return 1;
+}
+
+/** Steps of the landmark compaction per tick (see Landmarks::compact). */
+static const unsigned int COMPACTION_STEPS = 8;
+
 // TODO new method for choose dirt or road track
-FSMDriver::FSMDriver() : current_state(nullptr), previous_state(nullptr), tested(UNKN), threshold(11.6035) {
+FSMDriver::FSMDriver() : current_state(nullptr), previous_state(nullptr), tested(UNKN), surface_set(false),
+                         threshold(11.6035), test_braking(false) {
 }
 
 FSMDriver::~FSMDriver() {
-	/* Nothing */
+#ifdef __CARSTATE_ACCESS_STATS__
+	printReads();
+#endif
+}
+
+void
+FSMDriver::onRestart() {
+    cout << "Restarting the race!" << endl;
+}
+
+void
+FSMDriver::onShutdown() {
+    cout << "End of race!" << endl;
+    cout << this->trackName << endl;
+    saveKnowledge();
+}
+
+/**
+* Initializing the NUM_SENSORS track's angles using a gausian configuration, in order to make more sensors directed to the front of the car and consequently improve a curve detection
+*/
+void
+FSMDriver::init(float *angles){
+    for (int i = 0; i < NUM_SENSORS; ++i)
+        angles[i]=signum((i*1.0/3)-3)*exp(-(0.5)*powf((((i+9)%18)*1.0/3)-3, 2))*90;
+
+    // The surface found in the warmup (parameters of the later stages)
+    if (stage != BaseDriver::WARMUP)
+        setSurface(profile.load(this->trackName));
+    if (watchFiles && !profile.watch())
+        cout << "Cannot watch the track profile" << endl;
+
+    loadKnowledge();
 }
 
 void
@@ -30,33 +75,175 @@ FSMDriver::revertState() {
 }
 
 CarControl
-FSMDriver::wDrive(CarState cs) {
+FSMDriver::wDrive(const CarState &cs) {
+    const char *from = stateName();
+    speed_caps.reach(cs.getDistFromStart());
+    memory.compact(COMPACTION_STEPS);
+    long long start = LatencyStats::now();
     transition(cs);
-    if(tested == UNKN && stage == BaseDriver::WARMUP)   return testTrack(cs);
-    else    return current_state->drive(cs);
+    long long transitioned = LatencyStats::now();
+    latency.record(LatencyStats::TRANSITION, transitioned - start);
+#ifdef __CARSTATE_ACCESS_STATS__
+    countReads("transition", cs);
+    if(tested == UNKN && stage == BaseDriver::WARMUP) {
+        CarControl cc = testTrack(cs);
+        countReads("testTrack", cs);
+        latency.record(LatencyStats::DRIVE, LatencyStats::now() - transitioned);
+        trace.record(start, from, stateName(), cs.getDistFromStart(), cc);
+        return cc;
+    }
+    CarControl cc = stateDrive(cs);
+    countReads(stateName(), cs);
+#else
+    CarControl cc = (tested == UNKN && stage == BaseDriver::WARMUP) ? testTrack(cs)
+                                                                    : stateDrive(cs);
+#endif
+    latency.record(LatencyStats::DRIVE, LatencyStats::now() - transitioned);
+    trace.record(start, from, stateName(), cs.getDistFromStart(), cc);
+    return cc;
+}
+
+CarControl
+FSMDriver::fallbackControl(const CarControl &last) {
+    if (tested == UNKN && stage == BaseDriver::WARMUP)
+        return last;
+    return stateFallback(last);
+}
+
+CarControl
+FSMDriver::stateDrive(const CarState &cs) {
+    return current_state->drive(cs);
+}
+
+CarControl
+FSMDriver::stateFallback(const CarControl &last) const {
+    return current_state == nullptr ? last : current_state->fallback(last);
+}
+
+const char *
+FSMDriver::stateName() const {
+    return current_state->name();
+}
+
+void
+FSMDriver::addLandmark(const Knowledge &k) {
+    memory.insert(k);
+    speed_caps.add(k);
+}
+
+void
+FSMDriver::loadKnowledge() {
+    // Read the file, online learning
+    string trackFile = this->trackName;
+    trackFile += ".bin";
+    cout << trackFile << endl;
+    if (!knowledge_file.open(trackFile.c_str())) {
+        memory.clear();
+        speed_caps.assign(memory);
+        return;
+    }
+    memory.assign(knowledge_file.data(), knowledge_file.size());
+    speed_caps.assign(memory);
+
+    cout << "Read the file, online learning " << knowledge_file.size() << endl;
+}
+
+void
+FSMDriver::saveKnowledge() {
+    // Write file, online learning
+    if (!saveFiles || string(this->trackName) == string("unknown"))
+        return;
+    string trackFile = this->trackName;
+    trackFile += ".bin";
+    if (!KnowledgeFile::write(trackFile.c_str(), memory))
+        cout << "Cannot write " << trackFile << endl;
+    cout << "landmarks " << memory.size()*sizeof(Knowledge) << endl;
+}
+
+bool
+FSMDriver::dumpTrace(const char *path) {
+    return trace.dump(path);
+}
+
+void
+FSMDriver::setROAD() {
+    /* Nothing. */
+}
+
+void
+FSMDriver::setDIRT() {
+    /* Nothing. */
+}
+
+void
+FSMDriver::setSurface(int surface) {
+    if(surface == ROAD)         setROAD();
+    else if(surface == DIRT)    setDIRT();
+}
+
+void
+FSMDriver::updateSurface() {
+    if((road_or_dirt == "ROAD") && !surface_set) {
+        setROAD();
+        cout << "ROAD" << endl;
+        surface_set = true;
+        if (saveFiles) profile.save(this->trackName, ROAD);
+    }
+    else if(road_or_dirt == "DIRT" && !surface_set) {
+        setDIRT();
+        cout << "DIRT" << endl;
+        surface_set = true;
+        if (saveFiles) profile.save(this->trackName, DIRT);
+    }
+
+    // The surface found in the warmup is applied at init, and again only if
+    // the profile is edited
+    if (stage != BaseDriver::WARMUP && profile.changed())
+        setSurface(profile.load(this->trackName));
+}
+
+#ifdef __CARSTATE_ACCESS_STATS__
+void
+FSMDriver::countReads(const char *who, const CarState &cs) {
+    std::vector<unsigned long> &reads = sensor_reads[who];
+    reads.resize(CarState::FIELDS_NUM);
+    for (int i = 0; i < CarState::FIELDS_NUM; ++i)
+        reads[i] += cs.getReads(i);
+    cs.clearReads();
+}
+
+void
+FSMDriver::printReads() {
+    cout << "Sensor reads" << endl << "field";
+    for (auto &reader : sensor_reads)
+        cout << "\t" << reader.first;
+    cout << endl;
+    for (int i = 0; i < CarState::FIELDS_NUM; ++i) {
+        cout << CarState::FIELDS[i].tag;
+        for (auto &reader : sensor_reads)
+            cout << "\t" << reader.second[i];
+        cout << endl;
+    }
 }
+#endif
 
 CarControl
-FSMDriver::testTrack(CarState cs)
+FSMDriver::testTrack(const CarState &cs)
 {
-    static bool flag = false, flag2 = false;
     float accel = 1, steer = 0, brake = 0, clutch = 0;
     int gear = 1, focus = 0, meta = 0;
 
-    if(cs.getSpeedX() >= 80) {
-        flag2 = true;
-        if(!flag){
-            dist = cs.getDistRaced();
-            flag = true;
-        }
+    if(cs.getSpeedX() >= 80 && !test_braking) {
+        dist = cs.getDistRaced();
+        test_braking = true;
     }
-    if(cs.getSpeedX() <= 2 && flag2) {
+    if(cs.getSpeedX() <= 2 && test_braking) {
         dist = dist - cs.getDistRaced();
         // cout << "Dist = " << dist << endl;
         if(-dist < threshold)   tested = ROAD;
         else                    tested = DIRT;
     }
-    if(flag2) {
+    if(test_braking) {
         accel = 0;
         brake = 1;
     }
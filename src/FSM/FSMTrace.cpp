@@ -0,0 +1,140 @@
+/**  @file: FSMTrace.cpp
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#include "FSMTrace.h"
+
+#include <cstdio>
+#include <cstring>
+
+const char FSMTrace::MAGIC[8] = {'F','S','M','T','R','C','\0','\1'};
+const unsigned int FSMTrace::CAPACITY;
+const size_t FSMTrace::RECORD_LEN;
+
+static void
+putLE(char *p, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        p[i] = (char) (value >> (8*i));
+}
+
+static unsigned long long
+getLE(const char *p, int bytes) {
+    unsigned long long value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (unsigned long long) (unsigned char) p[i] << (8*i);
+    return value;
+}
+
+static unsigned int
+floatBits(float f) {
+    unsigned int bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static float
+bitsFloat(unsigned int bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+FSMTrace::FSMTrace()
+    : records(CAPACITY), ticks(0), pendingGuards(NONE), pendingRule(NONE), statesNum(0) {
+}
+
+bool
+FSMTrace::dump(const char *path) const {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+
+    std::vector<char> bytes(MAGIC, MAGIC + sizeof(MAGIC));
+    bytes.push_back((char) statesNum);
+    for (unsigned int i = 0; i < statesNum; ++i)
+        bytes.insert(bytes.end(), states[i], states[i] + strlen(states[i]) + 1);
+
+    unsigned int kept = ticks < CAPACITY ? ticks : CAPACITY;
+    size_t at = bytes.size();
+    bytes.resize(at + 4 + kept*RECORD_LEN);
+    putLE(&bytes[at], kept, 4);
+    char *p = &bytes[at + 4];
+    for (unsigned int t = ticks - kept; t != ticks; ++t, p += RECORD_LEN) {
+        const trecord &r = records[t & (CAPACITY-1)];
+        putLE(p, r.time, 8);
+        putLE(p+8, r.tick, 4);
+        putLE(p+12, floatBits(r.distFromStart), 4);
+        p[16] = r.from;
+        p[17] = r.to;
+        p[18] = r.guards;
+        p[19] = r.rule;
+        putLE(p+20, floatBits(r.accel), 4);
+        putLE(p+24, floatBits(r.brake), 4);
+        putLE(p+28, floatBits(r.steer), 4);
+        putLE(p+32, floatBits(r.clutch), 4);
+        putLE(p+36, (unsigned int) r.gear, 4);
+    }
+
+    bool written = fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && written;
+}
+
+bool
+FSMTrace::load(const char *path, std::vector<std::string> &states, std::vector<trecord> &records) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+    std::vector<char> bytes;
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        bytes.insert(bytes.end(), chunk, chunk + n);
+    fclose(file);
+
+    if (bytes.size() < sizeof(MAGIC) + 1 || memcmp(&bytes[0], MAGIC, sizeof(MAGIC)) != 0)
+        return false;
+
+    size_t p = sizeof(MAGIC);
+    unsigned int statesNum = (unsigned char) bytes[p++];
+    states.clear();
+    for (unsigned int i = 0; i < statesNum; ++i) {
+        const char *name = &bytes[p];
+        size_t len = strnlen(name, bytes.size() - p);
+        if (p + len >= bytes.size())
+            return false;
+        states.push_back(std::string(name, len));
+        p += len + 1;
+    }
+
+    if (p + 4 > bytes.size())
+        return false;
+    unsigned int kept = getLE(&bytes[p], 4);
+    p += 4;
+    if (p + (size_t) kept*RECORD_LEN > bytes.size())
+        return false;
+
+    records.resize(kept);
+    for (unsigned int i = 0; i < kept; ++i, p += RECORD_LEN) {
+        const char *b = &bytes[p];
+        trecord &r = records[i];
+        r.time = getLE(b, 8);
+        r.tick = getLE(b+8, 4);
+        r.distFromStart = bitsFloat(getLE(b+12, 4));
+        r.from = b[16];
+        r.to = b[17];
+        r.guards = b[18];
+        r.rule = b[19];
+        r.accel = bitsFloat(getLE(b+20, 4));
+        r.brake = bitsFloat(getLE(b+24, 4));
+        r.steer = bitsFloat(getLE(b+28, 4));
+        r.clutch = bitsFloat(getLE(b+32, 4));
+        r.gear = (int) getLE(b+36, 4);
+    }
+    return true;
+}
@@ -67,17 +67,17 @@ InsideTrackA::shouldIncreaseGear(int current_gear, int rpm) {
 }
 
 bool
-InsideTrackA::isFacingWrongWay(CarState &cs) {
+InsideTrackA::isFacingWrongWay(const CarState &cs) {
     return cs.getAngle() < -M_PI/2 || cs.getAngle() > M_PI/2;
 }
 
 void
-InsideTrackA::setTargetSpeed(CarState &cs) {
+InsideTrackA::setTargetSpeed(const CarState &cs) {
     this->target_speed = base_speed + speed_factor*this->distance;
 }
 
 float
-InsideTrackA::findFarthestDirection(CarState &cs) {
+InsideTrackA::findFarthestDirection(const CarState &cs) {
     float farthestSensor = -INFINITY;
     float farthestDirection = 0;
        for (int i = 0; i < 19; i++) { 
@@ -97,6 +97,11 @@ InsideTrackA::normalizeSteer(float angle) {
     return angle/maxsteer;
 }
 
+const char *
+InsideTrackA::name() const {
+    return "InsideTrackA";
+}
+
 InsideTrackA::~InsideTrackA() {
     /* Nothing. */
 }
@@ -106,12 +111,12 @@ InsideTrackA::~InsideTrackA() {
 /**************************************************************************
  * Modularization*/
 float
-InsideTrackA::get_steer(CarState &cs) {
+InsideTrackA::get_steer(const CarState &cs) {
     return isFacingWrongWay(cs) ? cs.getAngle() : findFarthestDirection(cs);
 }
 
 int
-InsideTrackA::get_gear(CarState &cs){
+InsideTrackA::get_gear(const CarState &cs){
     int gear = cs.getGear();
     if(gear <= 0) return start_gear;
 
@@ -124,7 +129,7 @@ InsideTrackA::get_gear(CarState &cs){
 }
 
 float
-InsideTrackA::get_accel(CarState &cs){
+InsideTrackA::get_accel(const CarState &cs){
     setTargetSpeed(cs);
     float Front, max10, max20;
 
@@ -144,11 +149,11 @@ InsideTrackA::get_accel(CarState &cs){
 }
 
 float
-InsideTrackA::get_brake(CarState &cs){
+InsideTrackA::get_brake(const CarState &cs){
     return cs.getSpeedX() > target_speed ? 0.3 : 0;
 }
 
 float
-InsideTrackA::get_clutch(CarState &cs){
+InsideTrackA::get_clutch(const CarState &cs){
     return 0;
 }
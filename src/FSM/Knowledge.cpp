@@ -10,8 +10,6 @@
 
 #include "Knowledge.h"
 
-std::vector<Knowledge> memory = std::vector<Knowledge>();
-
 Knowledge::Knowledge() {
     /* Nothing. */
 }
@@ -0,0 +1,284 @@
+/**  @file: KnowledgeFile.cpp
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#include "KnowledgeFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+const char KnowledgeFile::MAGIC[8] = {'F','S','M','K','N','O','W','\0'};
+const unsigned int KnowledgeFile::VERSION;
+const size_t KnowledgeFile::HEADER_LEN;
+const size_t KnowledgeFile::RECORD_LEN;
+const size_t KnowledgeFile::STAGING_LEN;
+
+static_assert(sizeof(Knowledge) == KnowledgeFile::RECORD_LEN, "a landmark of the file is a Knowledge");
+
+static void
+putLE(char *p, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        p[i] = (char) (value >> (8*i));
+}
+
+static unsigned long long
+getLE(const char *p, int bytes) {
+    unsigned long long value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (unsigned long long) (unsigned char) p[i] << (8*i);
+    return value;
+}
+
+static void
+putFloat(char *p, float f) {
+    unsigned int bits;
+    memcpy(&bits, &f, sizeof(bits));
+    putLE(p, bits, 4);
+}
+
+static float
+getFloat(const char *p) {
+    unsigned int bits = getLE(p, 4);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/** A little-endian 32 bit word (written out, so it compiles to a load). */
+static unsigned int
+getWord(const char *p) {
+    const unsigned char *b = (const unsigned char *) p;
+    return b[0] | b[1] << 8 | b[2] << 16 | (unsigned int) b[3] << 24;
+}
+
+/** Fletcher checksum of the 32 bit words of the landmarks (len is a
+ * multiple of 4): the sum of the words, and the sum of those sums, modulo
+ * 2^32. Going on from a previous checksum. */
+static unsigned long long
+checksum(const char *p, size_t len, unsigned long long previous = 0) {
+    unsigned int sum = previous, sums = previous >> 32;
+    for (size_t i = 0; i < len; i += 4) {
+        sum += getWord(p + i);
+        sums += sum;
+    }
+    return (unsigned long long) sums << 32 | sum;
+}
+
+/** Renames a file over another: rename() does not replace one on Windows. */
+static bool
+replace(const char *from, const char *to) {
+#ifdef WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+#ifdef __linux__
+/** The permissions fopen gives a new file: 0666 less the umask, which can
+ * only be read by setting it (so it is set back at once). */
+static mode_t
+creationMode() {
+    mode_t mask = umask(0);
+    umask(mask);
+    return 0666 & ~mask;
+}
+#endif
+
+static bool
+littleEndian() {
+    const unsigned short one = 1;
+    return *(const unsigned char *) &one == 1;
+}
+
+KnowledgeFile::KnowledgeFile() : records(NULL), count(0), mapped(NULL), mappedLen(0) {
+}
+
+KnowledgeFile::~KnowledgeFile() {
+    close();
+}
+
+void
+KnowledgeFile::close() {
+#ifdef __linux__
+    if (mapped != NULL)
+        munmap(mapped, mappedLen);
+#endif
+    mapped = NULL;
+    mappedLen = 0;
+    copied.clear();
+    records = NULL;
+    count = 0;
+}
+
+bool
+KnowledgeFile::open(const char *path) {
+    close();
+
+    const char *bytes = NULL;
+    size_t len = 0;
+    std::vector<char> contents;
+#ifdef __linux__
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ::close(fd);
+        return false;
+    }
+    len = st.st_size;
+    if (len > 0) {
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        mapped = map;
+        mappedLen = len;
+        bytes = (const char *) map;
+    }
+    ::close(fd);
+#else
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        contents.insert(contents.end(), chunk, chunk + n);
+    fclose(file);
+    len = contents.size();
+    bytes = len ? &contents[0] : NULL;
+#endif
+
+    if (len >= HEADER_LEN && memcmp(bytes, MAGIC, sizeof(MAGIC)) == 0) {
+        size_t n = getLE(bytes+16, 8);
+        if (getLE(bytes+8, 4) != VERSION || getLE(bytes+12, 4) != RECORD_LEN
+            || n > (len - HEADER_LEN) / RECORD_LEN
+            || checksum(bytes + HEADER_LEN, n*RECORD_LEN) != getLE(bytes+24, 8)) {
+            close();
+            return false;
+        }
+        const char *p = bytes + HEADER_LEN;
+        if (littleEndian() && mapped != NULL) {
+            records = reinterpret_cast<const Knowledge *>(p);
+        } else {
+            copied.resize(n);
+            for (size_t i = 0; i < n; ++i, p += RECORD_LEN)
+                copied[i] = Knowledge(getFloat(p), getFloat(p+4));
+            records = copied.data();
+        }
+        count = n;
+        if (!Landmarks::ordered(records, count)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // A file of the first drivers: the landmarks as they were in memory.
+    // It has no checksum, so anything else (a damaged header, a file cut
+    // short) must not pass for one: whole landmarks, of speeds and
+    // distances that are finite and not negative.
+    if (len % sizeof(Knowledge) != 0) {
+        close();
+        return false;
+    }
+    count = len / sizeof(Knowledge);
+    records = reinterpret_cast<const Knowledge *>(bytes);
+    if (mapped == NULL) {
+        copied.assign(records, records + count);
+        records = copied.data();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!(std::isfinite(records[i].targetSpeed) && records[i].targetSpeed >= 0
+              && std::isfinite(records[i].landmark) && records[i].landmark >= 0)) {
+            close();
+            return false;
+        }
+    }
+    if (!Landmarks::ordered(records, count)) {
+        std::vector<Knowledge> sorted(records, records + count);
+        std::sort(sorted.begin(), sorted.end(), Knowledge::aux_sort);
+        copied.swap(sorted);
+        records = copied.data();
+    }
+    return true;
+}
+
+bool
+KnowledgeFile::write(const char *path, const Landmarks &landmarks) {
+#ifdef __linux__
+    // a name of its own next to the file, so writers do not share it
+    std::string temporary = std::string(path) + ".XXXXXX";
+    int fd = mkstemp(&temporary[0]);
+    if (fd < 0)
+        return false;
+    // mkstemp creates it for the user only; it gets the permissions fopen
+    // would give it
+    FILE *file = fchmod(fd, creationMode()) == 0 ? fdopen(fd, "wb") : NULL;
+    if (file == NULL) {
+        ::close(fd);
+        remove(temporary.c_str());
+        return false;
+    }
+#else
+    std::string temporary = std::string(path) + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+        return false;
+#endif
+
+    char header[HEADER_LEN] = {0};
+    bool written = fwrite(header, sizeof(header), 1, file) == 1;
+
+    std::vector<char> staging(STAGING_LEN*RECORD_LEN);
+    size_t staged = 0, n = 0;
+    unsigned long long hash = checksum(NULL, 0);
+    landmarks.forEachCompacted([&](const Knowledge &k) {
+        char *p = &staging[staged*RECORD_LEN];
+        putFloat(p, k.targetSpeed);
+        putFloat(p+4, k.landmark);
+        n++;
+        if (++staged == STAGING_LEN) {
+            hash = checksum(&staging[0], staged*RECORD_LEN, hash);
+            written = written && fwrite(&staging[0], RECORD_LEN, staged, file) == staged;
+            staged = 0;
+        }
+    });
+    hash = checksum(&staging[0], staged*RECORD_LEN, hash);
+    written = written && fwrite(&staging[0], RECORD_LEN, staged, file) == staged;
+
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    putLE(header+8, VERSION, 4);
+    putLE(header+12, RECORD_LEN, 4);
+    putLE(header+16, n, 8);
+    putLE(header+24, hash, 8);
+    written = written && fseek(file, 0, SEEK_SET) == 0 && fwrite(header, sizeof(header), 1, file) == 1;
+
+    if (fclose(file) != 0 || !written || !replace(temporary.c_str(), path)) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
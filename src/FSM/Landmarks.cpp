@@ -0,0 +1,181 @@
+/**  @file: Landmarks.cpp
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#include "Landmarks.h"
+
+#include <algorithm>
+#include <iterator>
+
+const float Landmarks::RADIUS = 5;
+const size_t Landmarks::LIMIT;
+
+void
+Landmarks::setCompaction(float radius, size_t limit) {
+    this->radius = radius;
+    this->limit = std::max(limit, (size_t) 2);
+}
+
+void
+Landmarks::assign(const Knowledge *k, size_t n) {
+    added.clear();
+    cursor = added.end();
+    sweeping = inserted = false;
+
+    bool compact = n <= limit / 2;
+    for (size_t i = 1; compact && i < n; ++i)
+        compact = !together(k[i-1], k[i]);
+    if (compact) {
+        owned.clear();
+        base = k;
+        baseCount = n;
+        return;
+    }
+
+    // merged, with a larger radius while there are too many of them
+    std::vector<Knowledge> merged;
+    Landmarks runs;
+    runs.base = k;
+    runs.baseCount = n;
+    for (runs.radius = radius; ; runs.radius = runs.radius > 0 ? 2*runs.radius : 1) {
+        merged.clear();
+        runs.forEachCompacted([&merged](const Knowledge &m) { merged.push_back(m); });
+        if (merged.size() <= limit / 2)
+            break;
+    }
+    owned.swap(merged);
+    base = owned.data();
+    baseCount = owned.size();
+}
+
+void
+Landmarks::insert(const Knowledge &k) {
+    if (size() < limit)
+        added.insert(k);
+    else
+        merge(k);
+    // a pass from the start, or another one after this if it is on (k may
+    // be behind it)
+    if (sweeping) {
+        inserted = true;
+    } else {
+        sweeping = true;
+        cursor = added.begin();
+    }
+}
+
+void
+Landmarks::merge(const Knowledge &k) {
+    // there are at least limit/2 landmarks learnt, as there are at most as
+    // many known at init (unless the limit was lowered after the assign)
+    if (added.empty()) {
+        added.insert(k);
+        return;
+    }
+    tset::iterator next = added.lower_bound(k), nearest = next;
+    if (next == added.end() || (next != added.begin()
+                                && k.landmark - std::prev(next)->landmark < next->landmark - k.landmark))
+        nearest = std::prev(next);
+    Knowledge merged(std::min(k.targetSpeed, nearest->targetSpeed), std::min(k.landmark, nearest->landmark));
+    bool atCursor = nearest == cursor;
+    tset::iterator m = added.insert(added.erase(nearest), merged);
+    if (atCursor)
+        cursor = m;
+}
+
+bool
+Landmarks::covered(const Knowledge &k) const {
+    const Knowledge *b = std::lower_bound(base, base + baseCount, Knowledge(0, k.landmark - radius), ByLandmark());
+    for (; b != base + baseCount && b->landmark <= k.landmark + radius; ++b)
+        if (together(*b, k) && b->targetSpeed <= k.targetSpeed)
+            return true;
+    return false;
+}
+
+bool
+Landmarks::compact(unsigned int steps) {
+    while (sweeping && steps > 0) {
+        if (cursor == added.end()) {
+            // the pass is over: another one if landmarks were added during it
+            --steps;
+            sweeping = inserted;
+            inserted = false;
+            cursor = added.begin();
+            continue;
+        }
+
+        // the landmarks of its stretch after it, a step each, so a call
+        // merges at least one
+        tset::iterator it = cursor, next = std::next(it);
+        float speed = it->targetSpeed;
+        while (next != added.end() && together(*it, *next) && steps > 0) {
+            speed = std::min(speed, next->targetSpeed);
+            next = added.erase(next);
+            --steps;
+        }
+        bool done = next == added.end() || !together(*it, *next);
+        if (speed < it->targetSpeed) {
+            Knowledge k(speed, it->landmark);
+            it = added.insert(added.erase(it), k);
+        }
+        if (!done) {
+            cursor = it;
+            break;
+        }
+        // moving on to the next stretch is a step, or the last merge's
+        if (steps > 0)
+            --steps;
+        cursor = next;
+        if (covered(*it))
+            added.erase(it);
+    }
+    return sweeping;
+}
+
+void
+Landmarks::copy(std::vector<Knowledge> &out) const {
+    out.clear();
+    out.reserve(size());
+    forEach([&out](const Knowledge &k) { out.push_back(k); });
+}
+
+bool
+Landmarks::ordered(const Knowledge *k, size_t n) {
+    for (size_t i = 1; i < n; ++i)
+        if (k[i].landmark < k[i-1].landmark)
+            return false;
+    return true;
+}
+
+const Knowledge *
+Landmarks::first() const {
+    const Knowledge *b = baseCount ? base : NULL;
+    const Knowledge *a = added.empty() ? NULL : &*added.begin();
+    if (b == NULL) return a;
+    if (a == NULL) return b;
+    return ByLandmark()(*a, *b) ? a : b;
+}
+
+const Knowledge *
+Landmarks::from(float distFromStart) const {
+    Knowledge key(0, distFromStart);
+    const Knowledge *b = std::lower_bound(base, base + baseCount, key, ByLandmark());
+    if (b == base + baseCount) b = NULL;
+    tset::const_iterator next = added.lower_bound(key);
+    const Knowledge *a = next == added.end() ? NULL : &*next;
+    if (b == NULL) return a;
+    if (a == NULL) return b;
+    return ByLandmark()(*a, *b) ? a : b;
+}
+
+const Knowledge *
+Landmarks::ahead(float distFromStart) const {
+    const Knowledge *next = from(distFromStart);
+    return next ? next : first();
+}
@@ -25,57 +25,11 @@ OutOfTrack::setParameters(float _ms, float _nap, int _vg4, int _vg3, int _vg2, f
     min_return_angle = _minra;
 }
 
-float
-OutOfTrack::get_steer(CarState &cs) {
-    float angle = cs.getAngle();
-    if(cs.getTrackPos() > 0){
-        if(angle > max_return_angle) return 1;
-        if(angle < min_return_angle) return -1;
-    } else {
-        if(angle < -(max_return_angle)) return -1;
-        if(angle > -(min_return_angle)) return 1;
-    }
-
-    return 0;
-}
-
-int
-OutOfTrack::get_gear(CarState &cs) {
-    if(cs.getSpeedX() > velocity_gear_4) return cs.getGear(); 
-                                                            /* @todo need reverse behavior */
-    if(cs.getSpeedX() > velocity_gear_3) return 3;
-    if(cs.getSpeedX() > velocity_gear_2) return 2;
-
-    return 1;
-}
-
-float
-OutOfTrack::get_accel(CarState &cs) {
-    return(1-abs(cs.getSpeedY())*negative_accel_percent); /* @todo can be negative, need some fix */
-}
-
-float
-OutOfTrack::get_brake(CarState &cs) {
-    if(cs.getSpeedX() < 0) return 1;
-    if(abs(cs.getSpeedY()) > max_skidding) return 0.1;
-
-    return 0;
-}
-
-float
-OutOfTrack::get_clutch(CarState &cs){
-    return 0;
+const char *
+OutOfTrack::name() const {
+    return "OutOfTrack";
 }
 
-
 OutOfTrack::~OutOfTrack() {
     /* Nothing. */
 }
-
-CarControl
-OutOfTrack::drive(CarState &cs) {
-    const float clutch = 0;
-    const int focus = 0, meta = 0;
-
-    return CarControl(get_accel(cs), get_brake(cs), get_gear(cs), get_steer(cs), clutch, focus, meta);
-}
\ No newline at end of file
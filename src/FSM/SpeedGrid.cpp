@@ -0,0 +1,85 @@
+/**  @file: SpeedGrid.cpp
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#include "SpeedGrid.h"
+
+#include <algorithm>
+
+SpeedGrid::SpeedGrid(float binLength, float lookahead)
+    : binLength(binLength), window(std::max(1u, (unsigned int) ceilf(lookahead / binLength))), wraps(false),
+      last(0) {
+}
+
+void
+SpeedGrid::add(const Knowledge &k) {
+    if (!(k.landmark < MAX_LENGTH))
+        return;
+    unsigned int b = bin(k.landmark);
+    if (b >= caps.size())
+        grow(b + 1);
+    if (k.targetSpeed >= caps[b])
+        return;
+    caps[b] = k.targetSpeed;
+
+    // the windows that hold bin b: the window-1 bins behind it and its own,
+    // those behind the start of the lap only once it is known
+    unsigned int bins = caps.size();
+    unsigned int behind = wraps ? window : std::min(window, b + 1);
+    for (unsigned int i = 0; i < behind; ++i) {
+        unsigned int w = (b + bins - i) % bins;
+        ahead[w] = std::min(ahead[w], k.targetSpeed);
+    }
+}
+
+void
+SpeedGrid::assign(const Landmarks &landmarks) {
+    caps.assign(caps.size(), INFINITY);
+    landmarks.forEach([this](const Knowledge &k) {
+        if (!(k.landmark < MAX_LENGTH))
+            return;
+        unsigned int b = bin(k.landmark);
+        if (b >= caps.size()) {
+            caps.resize(b + 1, INFINITY);
+            ahead.resize(b + 1, INFINITY);
+        }
+        caps[b] = std::min(caps[b], k.targetSpeed);
+    });
+    refresh(0, caps.size());
+}
+
+void
+SpeedGrid::grow(unsigned int bins) {
+    unsigned int old = caps.size();
+    caps.resize(bins, INFINITY);
+    ahead.resize(bins, INFINITY);
+    // the new bins have no landmarks yet, so only windows that wrap to the
+    // start change: those of the old last bins and of the new ones
+    if (wraps)
+        refresh(old > window ? old - window : 0, bins);
+}
+
+void
+SpeedGrid::close() {
+    wraps = true;
+    unsigned int bins = caps.size();
+    refresh(bins > window ? bins - window : 0, bins);
+}
+
+void
+SpeedGrid::refresh(unsigned int from, unsigned int to) {
+    unsigned int bins = caps.size();
+    for (unsigned int b = from; b < to; ++b) {
+        unsigned int span = std::min(window, wraps ? bins : bins - b);
+        float lowest = INFINITY;
+        for (unsigned int i = 0; i < span; ++i)
+            lowest = std::min(lowest, caps[(b + i) % bins]);
+        ahead[b] = lowest;
+    }
+}
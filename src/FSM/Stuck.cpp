@@ -18,6 +18,11 @@ Stuck::Stuck(float ss, int mrd, int mst, int msst)
     maximum_number_of_ticks_in_slow_speed = msst;
 }
 
+const char *
+Stuck::name() const {
+    return "Stuck";
+}
+
 Stuck::~Stuck() {
     /* Nothing */
 }
@@ -30,111 +35,3 @@ Stuck::setParameters(float ss, int mrd, int mst, int msst)
     maximum_number_of_ticks_stuck = mst;
     maximum_number_of_ticks_in_slow_speed = msst;
 }
-
-bool
-Stuck::justStartedRace(CarState &cs) {
-    return (cs.getDistRaced() <= minimum_distance_raced);
-}
-
-
-bool
-Stuck::onRightWay(float track_pos, float angle) {
-    return (((track_pos < 0) && (angle > -M_PI/2) && (angle < 0)) ||
-            ((track_pos > 0) && (angle < M_PI/2) && (angle > 0)) ||
-            ((track_pos > 1) && (angle > 0))||
-            ((track_pos < -1) && (angle < 0)));
-}
-
-bool
-Stuck::notStuckAnymore(CarState &cs) {
-    return onRightWay(cs.getTrackPos(), cs.getAngle());
-}
-
-bool
-Stuck::hasBeenStuckLongEnough() {
-    return (elapsed_ticks >= maximum_number_of_ticks_stuck);
-}
-
-bool 
-Stuck::isStuck(CarState &cs) {
-    return (seemsStuck(cs) && !justStartedRace(cs));
-}
-
-bool
-Stuck::seemsStuck(CarState &cs) {
-    if(cs.getSpeedX() < stuck_speed)
-        ++slow_speed_ticks;
-    else
-        slow_speed_ticks = 0;
-
-    if(notStuckAnymore(cs))
-        slow_speed_ticks = 0;
-
-    return (slow_speed_ticks > maximum_number_of_ticks_in_slow_speed);
-}
-
-float
-Stuck::getInitialPos(CarState &cs) {
-	return (track_initial_pos == 0 ? cs.getTrackPos() : track_initial_pos);
-}
-
-float
-Stuck::auxSteer(float track_initial_pos, CarState &cs){
-    if(abs(cs.getAngle()) > M_PI) // around 180 graus
-        return (track_initial_pos > 0 ? -1 : 1);
-
-    return (track_initial_pos > 0 ? 1 : -1);
-}
-
-
-/**************************************************************************
- * Modularization*/
-float 
-Stuck::get_steer(CarState &cs) {
-    if(abs(cs.getAngle()) > M_PI) // around 180 graus
-    return (getInitialPos(cs) > 0 ? -1 : 1);
-
-    return (getInitialPos(cs) > 0 ? 1 : -1);
-}
-
-int
-Stuck::get_gear(CarState &cs){
-    return -1;
-}
-
-float
-Stuck::get_accel(CarState &cs){
-    return 1;
-}
-
-float
-Stuck::get_brake(CarState &cs){
-    return 0;
-}
-
-float
-Stuck::get_clutch(CarState &cs){
-    return 0;
-}
-
-CarControl
-Stuck::drive(CarState &cs) {
-    ++elapsed_ticks;
-
-    track_initial_pos = getInitialPos(cs);
-
-    if(notStuckAnymore(cs) || hasBeenStuckLongEnough()) {
-        elapsed_ticks = 0;
-        slow_speed_ticks = 0;
-        track_initial_pos = 0;
-    }
-
-    int gear = get_gear(cs);
-    float accel  = get_accel(cs);
-    float brake = get_brake(cs);
-    float clutch = get_clutch(cs);
-    const int focus = 0, meta = 0;
-    float steer = auxSteer(track_initial_pos, cs);
-
-    return CarControl(accel, brake, gear, steer, clutch, focus, meta);
-}
\ No newline at end of file
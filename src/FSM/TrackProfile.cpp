@@ -0,0 +1,138 @@
+/**  @file: TrackProfile.cpp
+ *
+ * https://github.com/bruno147/fsmdriver
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ */
+
+#include "TrackProfile.h"
+
+#include <cerrno>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/** Surfaces resolved so far, by track name, shared by every profile. */
+static std::map<std::string, int> surfaces;
+static std::mutex surfacesLock;
+
+TrackProfile::TrackProfile(const char *path)
+    : path(path), edits(0), loaded(0), notifyFd(-1) {
+    stopFd[0] = stopFd[1] = -1;
+}
+
+TrackProfile::~TrackProfile() {
+#ifdef __linux__
+    if (watcher.joinable()) {
+        char stop = 0;
+        while (write(stopFd[1], &stop, 1) < 0 && errno == EINTR) {}
+        watcher.join();
+    }
+    if (notifyFd >= 0) close(notifyFd);
+    if (stopFd[0] >= 0) close(stopFd[0]);
+    if (stopFd[1] >= 0) close(stopFd[1]);
+#endif
+}
+
+int
+TrackProfile::load(const char *trackName) {
+    loaded = edits.load();
+
+    std::lock_guard<std::mutex> guard(surfacesLock);
+    std::map<std::string, int>::iterator cached = surfaces.find(trackName);
+    if (cached != surfaces.end())
+        return cached->second;
+
+    std::ifstream file(path.c_str(), std::ios::in);
+    std::string line;
+    getline(file, line);
+
+    int surface = UNKN;
+    if (line == "ROAD")         surface = ROAD;
+    else if (line == "DIRT")    surface = DIRT;
+    surfaces[trackName] = surface;
+    return surface;
+}
+
+void
+TrackProfile::save(const char *trackName, int surface) {
+    {
+        std::lock_guard<std::mutex> guard(surfacesLock);
+        surfaces[trackName] = surface;
+    }
+
+    std::ofstream file(path.c_str(), std::ios_base::trunc);
+    file << (surface == ROAD ? "ROAD" : "DIRT") << std::endl;
+}
+
+bool
+TrackProfile::watch() {
+#ifdef __linux__
+    if (watcher.joinable())
+        return true;
+
+    // The directory is watched, as the file may not exist yet or be replaced
+    std::string::size_type slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash+1);
+
+    notifyFd = inotify_init1(IN_CLOEXEC);
+    if (notifyFd < 0)
+        return false;
+    if (inotify_add_watch(notifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0
+        || pipe(stopFd) < 0) {
+        close(notifyFd);
+        notifyFd = -1;
+        return false;
+    }
+    watcher = std::thread(&TrackProfile::run, this);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+TrackProfile::run() {
+#ifdef __linux__
+    std::string::size_type slash = path.rfind('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash+1);
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        struct pollfd fds[2] = {{notifyFd, POLLIN, 0}, {stopFd[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents)
+            return;
+
+        ssize_t len = read(notifyFd, events, sizeof(events));
+        bool edited = false;
+        for (char *p = events; len > 0 && p < events + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+            if (event->len > 0 && name == event->name)
+                edited = true;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+        if (!edited)
+            continue;
+
+        // the file holds the surface of whichever track it was written for
+        {
+            std::lock_guard<std::mutex> guard(surfacesLock);
+            surfaces.clear();
+        }
+        edits++;
+    }
+#endif
+}
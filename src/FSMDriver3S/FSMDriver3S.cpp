@@ -0,0 +1,64 @@
+/**  @file: FSMDriver3S.cpp
+ *
+ * https://github.com/bruno147/fsmdriver
+ * 
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. 
+ */
+
+#include "FSMDriver3S.h"
+
+//-------------------------------------------------------------------------------------------------------------------
+//FSMDriver3S Class
+
+/**
+*FSMDriver3S Constructor: it initilize at straightline state in the begining of the race, here the parameters are set with fixed values.
+*/
+FSMDriver3S::FSMDriver3S() {
+    tested = UNKNOWN;
+    fsm.get<InsideTrack>().setSpeedCaps(&speed_caps);
+    ThreeStateFSM::transitions(transitions, fsm.indexOf<Stuck>(), fsm.indexOf<InsideTrack>(), fsm.indexOf<OutOfTrack>());
+}
+
+/** Parameters Evolved with Genetic Algorithm. */
+void FSMDriver3S::setROAD() {
+    ThreeStateFSM::setROAD(fsm.get<InsideTrack>(), fsm.get<OutOfTrack>(), fsm.get<Stuck>());
+}
+
+/** Parameters Evolved with Genetic Algorithm. */
+void FSMDriver3S::setDIRT() {
+    ThreeStateFSM::setDIRT(fsm.get<InsideTrack>(), fsm.get<OutOfTrack>(), fsm.get<Stuck>());
+}
+
+/** The transition choose the most fitted state at the moment of the race. */
+void
+FSMDriver3S::transition(const CarState &cs) {
+    updateSurface();
+
+    unsigned int held;
+    const TransitionTable<FSMDriver3S, unsigned int>::tentry &to = transitions.evaluate(*this, cs, &held);
+    trace.cause(held, to.matched ? to.rule : FSMTrace::NONE);
+    if (to.action) to.action(*this, cs);
+    if (to.matched && fsm.at() != to.target) fsm.changeTo(to.target);
+}
+
+CarControl
+FSMDriver3S::stateDrive(const CarState &cs) {
+    return fsm.drive(cs);
+}
+
+CarControl
+FSMDriver3S::stateFallback(const CarControl &last) const {
+    return fsm.fallback(last);
+}
+
+const char *
+FSMDriver3S::stateName() const {
+    return fsm.name();
+}
+
+FSMDriver3S::~FSMDriver3S() {
+    /* Nothing */
+}
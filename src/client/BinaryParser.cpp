@@ -0,0 +1,107 @@
+/***************************************************************************
+
+    file                 : BinaryParser.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "BinaryParser.h"
+
+#include <stdint.h>
+
+const unsigned char BinaryParser::BINARY_MAGIC;
+const unsigned char BinaryParser::BINARY_VERSION;
+const unsigned char BinaryParser::BINARY_SENSORS;
+const unsigned char BinaryParser::BINARY_ACTION;
+const size_t BinaryParser::HEADER_LEN;
+
+const char *BinaryParser::WIRE_GROUP = "(wire binary)";
+
+// Every value takes 4 bytes on the wire, ints and floats alike.
+static_assert(sizeof(float) == 4 && sizeof(int) == 4, "the binary encoding needs 4 byte values");
+
+static inline uint32_t
+toLittleEndian(uint32_t v)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return __builtin_bswap32(v);
+#else
+	return v;
+#endif
+}
+
+size_t
+BinaryParser::length(const MessageSchema &schema)
+{
+	size_t values = 0;
+	for (int i = 0; i < schema.size; ++i)
+		values += schema.fields[i].arity;
+	return HEADER_LEN + 4*values;
+}
+
+bool
+BinaryParser::isBinary(const char *buf, size_t len, unsigned char kind)
+{
+	return len >= HEADER_LEN
+	    && (unsigned char) buf[0] == BINARY_MAGIC && buf[1] == 'B'
+	    && (unsigned char) buf[2] == BINARY_VERSION && (unsigned char) buf[3] == kind;
+}
+
+int
+BinaryParser::encode(const MessageSchema &schema, const void *object, unsigned char kind,
+                     char *buf, size_t size)
+{
+	if (size < length(schema))
+		return -1;
+
+	char *out = buf;
+	*out++ = (char) BINARY_MAGIC;
+	*out++ = 'B';
+	*out++ = (char) BINARY_VERSION;
+	*out++ = (char) kind;
+	for (int i = 0; i < schema.size; ++i)
+	{
+		const MessageField &field = schema.fields[i];
+		const char *base = (const char *) object + field.offset;
+		for (int j = 0; j < field.arity; ++j)
+		{
+			uint32_t v;
+			memcpy(&v, base + 4*j, 4);
+			v = toLittleEndian(v);
+			memcpy(out, &v, 4);
+			out += 4;
+		}
+	}
+	return out - buf;
+}
+
+bool
+BinaryParser::decode(const MessageSchema &schema, void *object, unsigned char kind,
+                     const char *buf, size_t len)
+{
+	if (!isBinary(buf, len, kind) || len < length(schema))
+		return false;
+
+	const char *in = buf + HEADER_LEN;
+	for (int i = 0; i < schema.size; ++i)
+	{
+		const MessageField &field = schema.fields[i];
+		char *base = (char *) object + field.offset;
+		for (int j = 0; j < field.arity; ++j)
+		{
+			uint32_t v;
+			memcpy(&v, in, 4);
+			v = toLittleEndian(v);
+			memcpy(base + 4*j, &v, 4);
+			in += 4;
+		}
+	}
+	return true;
+}
@@ -15,9 +15,40 @@
  ***************************************************************************/
 #include "CarControl.h"
 
+#include <cstddef>
+
 // meta-command value for race restart
 int CarControl::META_RESTART=1;
 
+const size_t CarControl::MAX_MSG_LEN;
+
+// Fields in the order they are sent to the server
+constexpr MessageField CarControl::FIELDS[] = {
+	SCHEMA_FIELD(CarControl, accel,  FIELD_FLOAT, 1),
+	SCHEMA_FIELD(CarControl, brake,  FIELD_FLOAT, 1),
+	SCHEMA_FIELD(CarControl, gear,   FIELD_INT,   1),
+	SCHEMA_FIELD(CarControl, steer,  FIELD_FLOAT, 1),
+	SCHEMA_FIELD(CarControl, clutch, FIELD_FLOAT, 1),
+	SCHEMA_FIELD(CarControl, focus,  FIELD_INT,   1),
+	SCHEMA_FIELD(CarControl, meta,   FIELD_INT,   1)
+};
+
+static const int FIELDS_NUM = sizeof(CarControl::FIELDS)/sizeof(CarControl::FIELDS[0]);
+
+static_assert(schemaMaxLength(CarControl::FIELDS, FIELDS_NUM, SimpleParser::MAX_NUMBER_LEN) <= CarControl::MAX_MSG_LEN,
+              "MAX_MSG_LEN is too short for the action message");
+
+const MessageSchema CarControl::SCHEMA = {
+	FIELDS, FIELDS_NUM, SchemaTable<CarControl::FIELDS, FIELDS_NUM>::slots
+};
+
+// Bit of a field in the mask returned by SimpleParser::parse
+constexpr unsigned long
+fieldBit(const char *tag)
+{
+	return 1ul << schemaIndex(CarControl::FIELDS, FIELDS_NUM, tag);
+}
+
 CarControl::CarControl(float accel, float brake, int gear, float steer, float clutch, int focus, int meta)
 {
 	this->accel = accel;
@@ -48,45 +79,51 @@ CarControl::CarControl(string sensors)
 string 
 CarControl::toString()
 {
-	string str;
-	
-	str  = SimpleParser::stringify("accel", accel);
-	str += SimpleParser::stringify("brake", brake);
-	str += SimpleParser::stringify("gear",  gear);
-	str += SimpleParser::stringify("steer", steer);
-	str += SimpleParser::stringify("clutch", clutch);
-	str += SimpleParser::stringify("focus",  focus);
-	str += SimpleParser::stringify("meta", meta);
-	
-	return str;	
+	char buf[MAX_MSG_LEN];
+	int len = toString(buf, sizeof(buf));
+	return string(buf, len);
+}
+
+int
+CarControl::toString(char *buf, size_t size) const
+{
+	return SimpleParser::stringify(SCHEMA, this, buf, size);
 }
 
 void 
 CarControl::fromString(string sensors)
 {
-	if (SimpleParser::parse(sensors, "accel", accel)==false)
+	unsigned long found = SimpleParser::parse(SCHEMA, this, sensors.c_str(), sensors.size());
+
+	if (!(found & fieldBit("accel")))
 		accel=0.0;
-	if (SimpleParser::parse(sensors, "brake", brake)==false)
+	if (!(found & fieldBit("brake")))
 		brake=0.0;
-	if (SimpleParser::parse(sensors, "gear",  gear)==false)
+	if (!(found & fieldBit("gear")))
 		gear=1;
-	if (SimpleParser::parse(sensors, "steer", steer)==false)
+	if (!(found & fieldBit("steer")))
 		steer=0.0;
-	if (SimpleParser::parse(sensors, "clutch", clutch)==false)
-			clutch=0.0;
-	if (SimpleParser::parse(sensors, "meta", meta)==false)
+	if (!(found & fieldBit("clutch")))
+		clutch=0.0;
+	if (!(found & fieldBit("meta")))
 		meta=0;
-	if (SimpleParser::parse(sensors, "focus", focus)==false) //ML
+	if (!(found & fieldBit("focus"))) //ML
 		focus=0; //ML
 	if (focus < -90 || focus > 90)//ML What to do with focus requests out of allowed range?
 		focus=360;//ML A value of 360 is used for not requesting focus readings; -1 is returned as focus reading to the client
 }
 
-float 
-CarControl::getAccel() const
+int
+CarControl::toBinary(char *buf, size_t size) const
 {
-        return this->accel;
-};
+	return BinaryParser::encode(SCHEMA, this, BinaryParser::BINARY_ACTION, buf, size);
+}
+
+bool
+CarControl::fromBinary(const char *buf, size_t len)
+{
+	return BinaryParser::decode(SCHEMA, this, BinaryParser::BINARY_ACTION, buf, len);
+}
 
 void 
 CarControl::setAccel (float accel)
@@ -94,36 +131,18 @@ CarControl::setAccel (float accel)
         this->accel = accel;
 };
 
-float 
-CarControl::getBrake() const
-{
-        return this->brake;
-};
-
 void 
 CarControl::setBrake (float brake)
 {
         this->brake = brake;
 };
 
-int
-CarControl::getGear() const
-{
-        return this->gear;
-};
-
 void 
 CarControl::setGear(int gear)
 {
         this->gear = gear;
 };
 
-float 
-CarControl::getSteer() const
-{
-        return this->steer;
-};
-
 void 
 CarControl::setSteer(float steer)
 {
@@ -142,12 +161,6 @@ CarControl::setMeta(int meta)
         this->meta = meta;
 };
 
-float
-CarControl::getClutch() const
-{
-       return clutch;
-}
-
 void
 CarControl::setClutch(float clutch)
 {
@@ -0,0 +1,247 @@
+/***************************************************************************
+
+    file                 : CarSession.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "CarSession.h"
+
+#include <cstdio>
+#include "BinaryParser.h"
+#include "CarControl.h"
+#include "SimpleParser.h"
+
+const int CarSession::MAX_SILENCE;
+const size_t CarSession::MAX_ACTION_LEN;
+
+CarSession::CarSession(BaseDriver &driver, const char *id, unsigned int maxEpisodes,
+                       unsigned int maxSteps, bool binaryWire)
+	: driver(driver), id(id), maxEpisodes(maxEpisodes), maxSteps(maxSteps),
+	  wantBinary(binaryWire), binaryWire(false), status(IDENTIFYING),
+	  curEpisode(0), currentStep(0), steps(0), dropped(0), silence(0), shutdownClient(false),
+	  deadline(NULL), restartedAt(0)
+{
+}
+
+CarSession::~CarSession()
+{
+	delete deadline;
+}
+
+void
+CarSession::setBudget(long budget)
+{
+	delete deadline;
+	deadline = budget > 0 ? new DeadlineDriver(driver, budget, MAX_ACTION_LEN) : NULL;
+}
+
+bool
+CarSession::record(const char *path)
+{
+	return recorder.open(path, id, driver.trackName, driver.stage);
+}
+
+int
+CarSession::identification(char *buf, size_t size)
+{
+	if (!init.empty())
+	{
+		if (init.length() >= size)
+			return -1;
+		memcpy(buf, init.c_str(), init.length() + 1);
+		return init.length();
+	}
+
+	// Initialize the angles of rangefinders
+	float angles[19];
+	driver.init(angles);
+
+	size_t idLen = strlen(id);
+	if (idLen >= size)
+		return -1;
+	memcpy(buf, id, idLen);
+	int n = SimpleParser::stringify(buf + idLen, size - idLen, "init", angles, 19);
+	if (n < 0)
+		return -1;
+	n += idLen;
+	if (wantBinary)
+	{
+		size_t groupLen = strlen(BinaryParser::WIRE_GROUP);
+		if (n + groupLen >= size)
+			return -1;
+		memcpy(buf + n, BinaryParser::WIRE_GROUP, groupLen + 1);
+		n += groupLen;
+	}
+	cout << "Sending id to server: " << id << endl;
+	cout << "Sending init string to the server: " << buf << endl;
+	init.assign(buf, n);
+	return n;
+}
+
+int
+CarSession::receive(const char *msg, size_t len, char *reply, size_t size)
+{
+	if (status == IDENTIFYING)
+	{
+		cout << "Received: " << msg << endl;
+		if (strcmp(msg,"***identified***")==0)
+			binaryWire = false;
+		// a server that speaks the binary encoding echoes the wire group
+		else if (wantBinary && strncmp(msg,"***identified***",16)==0
+		         && strcmp(msg+16,BinaryParser::WIRE_GROUP)==0)
+			binaryWire = true;
+		else
+			return 0;
+		status = DRIVING;
+		currentStep = 0;
+		return 0;
+	}
+	if (status != DRIVING)
+		return 0;
+	silence = 0;
+
+#ifdef __UDP_CLIENT_VERBOSE__
+	if (!BinaryParser::isBinary(msg, len, BinaryParser::BINARY_SENSORS))
+		cout << "Received: " << msg << endl;
+#endif
+
+	if (strcmp(msg,"***shutdown***")==0)
+	{
+		recorder.record(SessionLog::SHUTDOWN, msg, len);
+		shutdownDriver();
+		shutdownClient = true;
+		status = FINISHED;
+		cout << "Client Shutdown" << endl;
+		return 0;
+	}
+
+	if (strcmp(msg,"***restart***")==0)
+	{
+		recorder.record(SessionLog::RESTART, msg, len);
+		if (deadline != NULL)
+			deadline->sync();
+		driver.onRestart();
+		restartedAt = LatencyStats::now();
+		cout << "Client Restart" << endl;
+		endEpisode();
+		return 0;
+	}
+
+	/**************************************************
+	 * Compute The Action to send to the solorace sever
+	 **************************************************/
+	int actionLen;
+	if ( (++currentStep) != maxSteps)
+	{
+		recorder.record(SessionLog::SENSORS, msg, len);
+		actionLen = deadline != NULL ? deadline->drive(msg, len, reply, size)
+		                             : driver.drive(msg, len, reply, size);
+		if (actionLen >= 0 && (size_t) actionLen < size)
+			recorder.record(SessionLog::ACTION, reply, actionLen);
+	}
+	else if (binaryWire)
+		actionLen = CarControl(0, 0, 1, 0, 0, 0, CarControl::META_RESTART).toBinary(reply, size);
+	else
+		actionLen = snprintf(reply, size, "(meta 1)");
+
+	if (actionLen < 0 || (size_t) actionLen >= size)
+	{
+		cerr << "action does not fit in " << size << " bytes\n";
+		return -1;
+	}
+	++steps;
+	if (restartedAt != 0)
+	{
+		driver.latency.record(LatencyStats::RESTART, LatencyStats::now() - restartedAt);
+		restartedAt = 0;
+	}
+
+#ifdef __UDP_CLIENT_VERBOSE__
+	if (!binaryWire)
+		cout << "Sending " << reply << endl;
+#endif
+	// text actions are sent with their terminating '\0'
+	return binaryWire ? actionLen : actionLen+1;
+}
+
+bool
+CarSession::isSensors(const char *msg) const
+{
+	return status == DRIVING && strcmp(msg,"***shutdown***") != 0
+	       && strcmp(msg,"***restart***") != 0;
+}
+
+void
+CarSession::drop()
+{
+	silence = 0;
+	dropped++;
+}
+
+void
+CarSession::timeout()
+{
+	if (status != DRIVING)
+		return;
+	silence++;
+	cout << "** Server did not respond in " << silence << " second.\n";
+	if (silence == MAX_SILENCE)
+	{
+		// the server is gone, there is no race to shut down
+		shutdownClient = true;
+		status = FINISHED;
+	}
+}
+
+void
+CarSession::endEpisode()
+{
+	if ( (++curEpisode) == maxEpisodes )
+		finish();
+	else
+		status = IDENTIFYING;
+}
+
+void
+CarSession::finish()
+{
+	if (shutdownClient==false)
+		shutdownDriver();
+	shutdownClient = true;
+	status = FINISHED;
+	recorder.close();
+}
+
+void
+CarSession::shutdownDriver()
+{
+	if (deadline != NULL)
+		deadline->sync();
+	driver.onShutdown();
+	printStats(cout);
+}
+
+void
+CarSession::printStats(ostream &out)
+{
+	// the worker thread must not be writing the latencies
+	if (deadline != NULL)
+		deadline->sync();
+	out << "Tick latency of " << id << ":" << endl;
+	driver.latency.print(out);
+	if (deadline != NULL)
+		out << "Budget of " << deadline->getBudget() << " us: " << deadline->getOverruns()
+		    << " overruns, " << deadline->getSkipped() << " skipped and "
+		    << deadline->getFallbacks() << " fallbacks in " << deadline->getTicks()
+		    << " ticks" << endl;
+	if (dropped > 0)
+		out << "Dropped " << dropped << " stale sensors" << endl;
+}
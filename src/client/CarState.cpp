@@ -15,294 +15,278 @@
  ***************************************************************************/
 #include "CarState.h"
 
+#include <cstddef>
+#include <type_traits>
+
+
+constexpr MessageField CarState::FIELDS[] = {
+        SCHEMA_FIELD(CarState, angle,         FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, curLapTime,    FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, damage,        FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, distFromStart, FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, distRaced,     FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, focus,         FIELD_FLOAT, FOCUS_SENSORS_NUM),
+        SCHEMA_FIELD(CarState, fuel,          FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, gear,          FIELD_INT,   1),
+        SCHEMA_FIELD(CarState, lastLapTime,   FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, opponents,     FIELD_FLOAT, OPPONENTS_SENSORS_NUM),
+        SCHEMA_FIELD(CarState, racePos,       FIELD_INT,   1),
+        SCHEMA_FIELD(CarState, rpm,           FIELD_INT,   1),
+        SCHEMA_FIELD(CarState, speedX,        FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, speedY,        FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, speedZ,        FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, track,         FIELD_FLOAT, TRACK_SENSORS_NUM),
+        SCHEMA_FIELD(CarState, trackPos,      FIELD_FLOAT, 1),
+        SCHEMA_FIELD(CarState, wheelSpinVel,  FIELD_FLOAT, 4),
+        SCHEMA_FIELD(CarState, z,             FIELD_FLOAT, 1)
+};
+
+static_assert(sizeof(CarState::FIELDS)/sizeof(CarState::FIELDS[0]) == CarState::FIELDS_NUM,
+              "CarState::FIELDS_NUM does not match FIELDS");
+
+const MessageSchema CarState::SCHEMA = {
+        FIELDS, FIELDS_NUM, SchemaTable<CarState::FIELDS, CarState::FIELDS_NUM>::slots
+};
+
+const int CarState::FIELDS_NUM;
+
+const size_t CarState::MAX_LAZY_MSG_LEN;
+
+const size_t CarState::MAX_MSG_LEN = schemaMaxLength(FIELDS, CarState::FIELDS_NUM, SimpleParser::MAX_NUMBER_LEN);
+
+// Index of a member in CarState::FIELDS, as a compile time constant
+#define FIELD_INDEX(m) std::integral_constant<int, schemaIndex(CarState::FIELDS, CarState::FIELDS_NUM, #m)>::value
+
+static_assert(FIELD_INDEX(angle) == CarState::ANGLE, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(curLapTime) == CarState::CUR_LAP_TIME, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(damage) == CarState::DAMAGE, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(distFromStart) == CarState::DIST_FROM_START, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(distRaced) == CarState::DIST_RACED, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(focus) == CarState::FOCUS, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(fuel) == CarState::FUEL, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(gear) == CarState::GEAR, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(lastLapTime) == CarState::LAST_LAP_TIME, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(opponents) == CarState::OPPONENTS, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(racePos) == CarState::RACE_POS, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(rpm) == CarState::RPM, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(speedX) == CarState::SPEED_X, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(speedY) == CarState::SPEED_Y, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(speedZ) == CarState::SPEED_Z, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(track) == CarState::TRACK, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(trackPos) == CarState::TRACK_POS, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(wheelSpinVel) == CarState::WHEEL_SPIN_VEL, "CarState::tfield does not match FIELDS");
+static_assert(FIELD_INDEX(z) == CarState::Z, "CarState::tfield does not match FIELDS");
+
+CarState::CarState(const string &sensors)
+        : source(NULL), pending(0)
+{
+        SimpleParser::parse(SCHEMA, this, sensors.c_str(), sensors.size());
+#ifdef __CARSTATE_ACCESS_STATS__
+        clearReads();
+#endif
+}
+
+CarState::CarState(const char *sensors, size_t len, bool lazy)
+        : source(NULL), pending(0)
+{
+        if (BinaryParser::isBinary(sensors, len, BinaryParser::BINARY_SENSORS))
+                BinaryParser::decode(SCHEMA, this, BinaryParser::BINARY_SENSORS, sensors, len);
+        else if (lazy && len <= MAX_LAZY_MSG_LEN)
+        {
+                source = sensors;
+                pending = SimpleParser::index(SCHEMA, sensors, len, valueBegin, valueEnd);
+        }
+        else
+                SimpleParser::parse(SCHEMA, this, sensors, len);
+#ifdef __CARSTATE_ACCESS_STATS__
+        clearReads();
+#endif
+}
+
+void
+CarState::decode(int i) const
+{
+        // Filling the cache of a lazy state does not change its value: the
+        // fields are mutable, and the schema places them from the first one
+        char *object = reinterpret_cast<char *>(&angle) - offsetof(CarState, angle);
+        SimpleParser::parseField(FIELDS[i], object, source + valueBegin[i], source + valueEnd[i]);
+        pending &= ~(1ul << i);
+}
+
+void
+CarState::fetchAll() const
+{
+        for (int i = 0; pending; ++i)
+                fetch(i);
+}
 
-CarState::CarState(string sensors)
+#ifdef __CARSTATE_ACCESS_STATS__
+unsigned int
+CarState::getReads(int field) const
+{
+        assert(field>=0 && field<FIELDS_NUM);
+        return reads[field];
+}
+
+void
+CarState::clearReads() const
 {
-        SimpleParser::parse(sensors, "angle", this->angle);
-        SimpleParser::parse(sensors, "curLapTime", this->curLapTime);
-        SimpleParser::parse(sensors, "damage", this->damage);
-        SimpleParser::parse(sensors, "distFromStart", this->distFromStart);
-        SimpleParser::parse(sensors, "distRaced", this->distRaced);
-        SimpleParser::parse(sensors, "focus", this->focus, FOCUS_SENSORS_NUM);
-        SimpleParser::parse(sensors, "fuel", this->fuel);
-        SimpleParser::parse(sensors, "gear", this->gear);
-        SimpleParser::parse(sensors, "lastLapTime", this->lastLapTime);
-        SimpleParser::parse(sensors, "opponents", this->opponents, OPPONENTS_SENSORS_NUM);
-        SimpleParser::parse(sensors, "racePos", this->racePos);
-        SimpleParser::parse(sensors, "rpm", this->rpm);
-        SimpleParser::parse(sensors, "speedX", this->speedX);
-        SimpleParser::parse(sensors, "speedY", this->speedY);
-        SimpleParser::parse(sensors, "speedZ", this->speedZ);
-        SimpleParser::parse(sensors, "track", this->track, TRACK_SENSORS_NUM);
-        SimpleParser::parse(sensors, "trackPos", this->trackPos);
-        SimpleParser::parse(sensors, "wheelSpinVel", this->wheelSpinVel, 4);
-        SimpleParser::parse(sensors, "z", this->z);
+        memset(reads, 0, sizeof(reads));
 }
+#endif
 
 string
 CarState::toString()
 {
-	string str;
-	str  = SimpleParser::stringify("angle", this->angle);
-	str += SimpleParser::stringify("curLapTime", this->curLapTime);
-	str += SimpleParser::stringify("damage", this->damage);
-	str += SimpleParser::stringify("distFromStart", this->distFromStart);
-	str += SimpleParser::stringify("distRaced", this->distRaced);
-	str += SimpleParser::stringify("focus", this->focus, FOCUS_SENSORS_NUM);
-	str += SimpleParser::stringify("fuel", this->fuel);
-	str += SimpleParser::stringify("gear", this->gear);
-	str += SimpleParser::stringify("lastLapTime", this->lastLapTime);
-	str += SimpleParser::stringify("opponents", this->opponents, OPPONENTS_SENSORS_NUM);
-	str += SimpleParser::stringify("racePos", this->racePos);
-	str += SimpleParser::stringify("rpm", this->rpm);
-	str += SimpleParser::stringify("speedX", this->speedX);
-	str += SimpleParser::stringify("speedY", this->speedY);
-	str += SimpleParser::stringify("speedZ", this->speedZ);
-	str += SimpleParser::stringify("track", this->track, TRACK_SENSORS_NUM);
-	str += SimpleParser::stringify("trackPos", this->trackPos);
-	str += SimpleParser::stringify("wheelSpinVel", this->wheelSpinVel, 4);
-	str += SimpleParser::stringify("z", this->z);
-	
-	return str;
-	        
+        fetchAll();
+	char buf[schemaMaxLength(FIELDS, CarState::FIELDS_NUM, SimpleParser::MAX_NUMBER_LEN)];
+	int len = SimpleParser::stringify(SCHEMA, this, buf, sizeof(buf));
+	return string(buf, len < 0 ? 0 : len);
 }
 
-float 
-CarState::getAngle()
+int
+CarState::toBinary(char *buf, size_t size)
 {
-        return angle;
-};
+        fetchAll();
+        return BinaryParser::encode(SCHEMA, this, BinaryParser::BINARY_SENSORS, buf, size);
+}
 
 void 
 CarState::setAngle(float angle)
 {
+        fetch(FIELD_INDEX(angle));
         this->angle = angle;
 };
 
-float 
-CarState::getCurLapTime()
-{
-        return curLapTime;
-};
-
 void 
 CarState::setCurLapTime(float curLapTime)
 {
+        fetch(FIELD_INDEX(curLapTime));
         this->curLapTime = curLapTime;
 };
 
-float
-CarState::getDamage()
-{
-        return damage;
-};
-
 void
 CarState::setDamage(float damage)
 {
+        fetch(FIELD_INDEX(damage));
         this->damage = damage;
 };
 
-float
-CarState::getDistFromStart()
-{
-        return distFromStart;
-};
-
 void
 CarState::setDistFromStart(float distFromStart)
 {
+        fetch(FIELD_INDEX(distFromStart));
         this->distFromStart = distFromStart;
 };
 
-float
-CarState::getDistRaced()
-{
-        return distRaced;
-};
-
 void
 CarState::setDistRaced(float distRaced)
 {
+        fetch(FIELD_INDEX(distRaced));
         this->distRaced = distRaced;
 };
 
-float
-CarState::getFocus(int i)
-{
-        assert(i>=0 && i<FOCUS_SENSORS_NUM);
-        return focus[i];
-};
-
 
 void
 CarState::setFocus(int i, float value)
 {
+        fetch(FIELD_INDEX(focus));
         assert(i>=0 && i<FOCUS_SENSORS_NUM);
         this->focus[i] = value;
 };
 
-float
-CarState::getFuel()
-{
-        return fuel;
-};
-
 void
 CarState::setFuel(float fuel)
 {
+        fetch(FIELD_INDEX(fuel));
         this->fuel = fuel;
 };
 
-int
-CarState::getGear()
-{
-        return gear;
-};
-
 void
 CarState::setGear(int gear)
 {
+        fetch(FIELD_INDEX(gear));
         this->gear = gear;
 };
 
-float 
-CarState::getLastLapTime()
-{
-        return lastLapTime;
-};
-
 void 
 CarState::setLastLapTime(float lastLapTime)
 {
+        fetch(FIELD_INDEX(lastLapTime));
         this->lastLapTime = lastLapTime;
 };
 
-float
-CarState::getOpponents(int i)
-{
-        assert(i>=0 && i<OPPONENTS_SENSORS_NUM);
-        return opponents[i];
-        
-};
-
 void
 CarState::setOpponents(int i, float value)
 {
+        fetch(FIELD_INDEX(opponents));
         assert(i>=0 && i<OPPONENTS_SENSORS_NUM);
         this->opponents[i] = value;
 };
 
-int
-CarState::getRacePos()
-{
-        return racePos;
-};
-
 void
 CarState::setRacePos(int racePos)
 {
+        fetch(FIELD_INDEX(racePos));
         this->racePos = racePos;
 };
 
-int
-CarState::getRpm()
-{
-        return rpm;
-};
-
 void
 CarState::setRpm(int rpm)
 {
+        fetch(FIELD_INDEX(rpm));
         this->rpm = rpm;
 };
 
-float
-CarState::getSpeedX()
-{
-        return speedX;
-};
-
 void
 CarState::setSpeedX(float speedX)
 {
+        fetch(FIELD_INDEX(speedX));
         this->speedX = speedX;
 };
 
-float
-CarState::getSpeedY()
-{
-        return speedY;
-};
-
 void
 CarState::setSpeedY(float speedY)
 {
+        fetch(FIELD_INDEX(speedY));
         this->speedY = speedY;
 };
 
-float
-CarState::getSpeedZ()
-{
-        return speedZ;
-};
-
 
 void
 CarState::setSpeedZ(float speedZ)
 {
+        fetch(FIELD_INDEX(speedZ));
         this->speedZ = speedZ;
 };
 
-float
-CarState::getTrack(int i)
-{
-        assert(i>=0 && i<TRACK_SENSORS_NUM);
-        return track[i];
-};
-
 
 void
 CarState::setTrack(int i, float value)
 {
+        fetch(FIELD_INDEX(track));
         assert(i>=0 && i<TRACK_SENSORS_NUM);
         this->track[i] = value;
 };
 
-float
-CarState::getTrackPos()
-{
-        return trackPos;
-};
-
 void
 CarState::setTrackPos(float prackPos)
 {
+        fetch(FIELD_INDEX(trackPos));
         this->trackPos = trackPos;
 };
 
-float 
-CarState::getWheelSpinVel(int i)
-{
-	assert(i>=0 && i<4);
-	return wheelSpinVel[i];
-}
-
 void 
 CarState::setWheelSpinVel(int i, float value)
 {
-	assert(i>=0 && i<4);
+        fetch(FIELD_INDEX(wheelSpinVel));
+        assert(i>=0 && i<4);
 	wheelSpinVel[i]=value;
 }
 
-float
-CarState::getZ()
-{
-        return z;
-};
-
 void
 CarState::setZ(float z)
 {
+        fetch(FIELD_INDEX(z));
     this->z = z;
 };
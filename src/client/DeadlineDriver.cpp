@@ -0,0 +1,138 @@
+/***************************************************************************
+
+    file                 : DeadlineDriver.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "DeadlineDriver.h"
+
+#include <chrono>
+
+// Copies a message of len bytes, with its '\0' if there is room for it
+static int
+copyMessage(char *to, size_t size, const vector<char> &from, int len)
+{
+	if (len < 0 || (size_t) len > size)
+		return -1;
+	memcpy(to, &from[0], (size_t) len < size ? len+1 : len);
+	return len;
+}
+
+DeadlineDriver::DeadlineDriver(BaseDriver &driver, long budget, size_t size)
+	: driver(driver), budget(budget), busy(false), stop(false),
+	  sensors(size+1), action(size+1), fallback(size+1),
+	  sensorsLen(0), actionLen(-1), fallbackLen(-1),
+	  ticks(0), overruns(0), skipped(0), fallbacks(0)
+{
+	worker = thread(&DeadlineDriver::work, this);
+}
+
+DeadlineDriver::~DeadlineDriver()
+{
+	{
+		unique_lock<mutex> guard(lock);
+		stop = true;
+	}
+	requested.notify_one();
+	worker.join();
+}
+
+int
+DeadlineDriver::drive(const char *msg, size_t len, char *buf, size_t size)
+{
+	unique_lock<mutex> guard(lock);
+	if (busy)
+	{
+		// still computing a late tick: this one gets the fallback
+		int n = sendFallback(buf, size);
+		if (n >= 0)
+		{
+			skipped++;
+			return n;
+		}
+		answered.wait(guard, [this]{ return !busy; });
+	}
+
+	if (len > sensors.size() - 1)
+		return -1;
+	memcpy(&sensors[0], msg, len);
+	sensors[len] = '\0';
+	sensorsLen = len;
+	busy = true;
+	requested.notify_one();
+
+	if (!answered.wait_for(guard, chrono::microseconds(budget), [this]{ return !busy; }))
+	{
+		overruns++;
+		int n = sendFallback(buf, size);
+		if (n >= 0)
+			return n;
+		// nothing to fall back on yet (first tick): wait for the driver
+		answered.wait(guard, [this]{ return !busy; });
+	}
+	return copyMessage(buf, size, action, actionLen);
+}
+
+void
+DeadlineDriver::sync()
+{
+	unique_lock<mutex> guard(lock);
+	answered.wait(guard, [this]{ return !busy; });
+}
+
+int
+DeadlineDriver::sendFallback(char *buf, size_t size)
+{
+	int n = copyMessage(buf, size, fallback, fallbackLen);
+	if (n >= 0)
+		fallbacks++;
+	return n;
+}
+
+void
+DeadlineDriver::work()
+{
+	// the driver writes into these outside the lock
+	vector<char> out(action.size()), safe(fallback.size());
+
+	unique_lock<mutex> guard(lock);
+	while (1)
+	{
+		requested.wait(guard, [this]{ return busy || stop; });
+		if (stop)
+			return;
+
+		guard.unlock();
+		int outLen = driver.drive(&sensors[0], sensorsLen, &out[0], out.size()-1);
+		// the fallback for the next tick is computed here too, while the
+		// driver is consistent
+		int safeLen = outLen >= 0 ? driver.fallback(&safe[0], safe.size()-1) : -1;
+		guard.lock();
+
+		actionLen = outLen;
+		if (outLen >= 0)
+			memcpy(&action[0], &out[0], outLen+1);
+		if (safeLen >= 0)
+		{
+			memcpy(&fallback[0], &safe[0], safeLen+1);
+			fallbackLen = safeLen;
+		}
+		else if (outLen >= 0)
+		{
+			// no fallback from the driver: repeat its last action
+			memcpy(&fallback[0], &out[0], outLen+1);
+			fallbackLen = outLen;
+		}
+		ticks++;
+		busy = false;
+		answered.notify_all();
+	}
+}
@@ -0,0 +1,308 @@
+/***************************************************************************
+
+    file                 : EventLoop.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "EventLoop.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <ctime>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// epoll data: the kind of source in the high word, its id in the low one
+static unsigned long long
+tag(EventLoop::tkind kind, int id)
+{
+	return ((unsigned long long) kind << 32) | (unsigned int) id;
+}
+
+EventLoop::EventLoop() : spin(0), epollFd(epoll_create1(EPOLL_CLOEXEC)), signalFd(-1)
+{
+}
+
+EventLoop::~EventLoop()
+{
+	for (size_t i = 0; i < timerFds.size(); i++)
+		if (timerFds[i] >= 0)
+			close(timerFds[i]);
+	if (signalFd >= 0)
+		close(signalFd);
+	if (epollFd >= 0)
+		close(epollFd);
+}
+
+bool
+EventLoop::isValid() const
+{
+	return epollFd >= 0;
+}
+
+bool
+EventLoop::watch(int fd, int id)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		return false;
+	struct epoll_event ev;
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.u64 = tag(READABLE, id);
+	return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+bool
+EventLoop::addTimer(int id)
+{
+	if (id < 0)
+		return false;
+	if ((size_t) id >= timerFds.size())
+		timerFds.resize(id+1, -1);
+	if (timerFds[id] >= 0)
+		return true;
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0)
+		return false;
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u64 = tag(TIMEOUT, id);
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+	{
+		close(fd);
+		return false;
+	}
+	timerFds[id] = fd;
+	return true;
+}
+
+void
+EventLoop::arm(int id, long usec)
+{
+	struct itimerspec spec;
+	spec.it_interval.tv_sec = 0;
+	spec.it_interval.tv_nsec = 0;
+	spec.it_value.tv_sec = usec / 1000000;
+	spec.it_value.tv_nsec = (usec % 1000000) * 1000;
+	timerfd_settime(timerFds[id], 0, &spec, NULL);
+}
+
+bool
+EventLoop::catchSignals()
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGUSR1);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0)
+		return false;
+	signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (signalFd < 0)
+		return false;
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u64 = tag(SIGNALED, 0);
+	return epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &ev) == 0;
+}
+
+int
+EventLoop::wait(tevent *events, int max)
+{
+	static const int MAX_READY = 64;
+	struct epoll_event ready[MAX_READY];
+	if (max > MAX_READY)
+		max = MAX_READY;
+	int n = 0;
+	if (spin > 0)
+	{
+		chrono::steady_clock::time_point until =
+			chrono::steady_clock::now() + chrono::microseconds(spin);
+		do
+			n = epoll_wait(epollFd, ready, max, 0);
+		while (n == 0 && chrono::steady_clock::now() < until);
+	}
+	while (n == 0 || (n < 0 && errno == EINTR))
+		n = epoll_wait(epollFd, ready, max, -1);
+
+	for (int i = 0; i < n; i++)
+	{
+		events[i].kind = (tkind) (ready[i].data.u64 >> 32);
+		events[i].id = (int) (ready[i].data.u64 & 0xFFFFFFFF);
+		// consume the expiration (or signal) so it is reported only once
+		if (events[i].kind == TIMEOUT)
+		{
+			unsigned long long expirations;
+			if (read(timerFds[events[i].id], &expirations, sizeof(expirations)) < 0)
+				expirations = 0;
+		}
+		else if (events[i].kind == SIGNALED)
+		{
+			// one signal per event, the others are reported by the next wait
+			struct signalfd_siginfo info;
+			if (read(signalFd, &info, sizeof(info)) == sizeof(info))
+				events[i].id = info.ssi_signo;
+		}
+	}
+	return n;
+}
+
+#else /* select fallback */
+
+#ifdef WIN32
+#include <WinSock.h>
+#else
+#include <fcntl.h>
+#include <sys/select.h>
+#endif
+
+static volatile sig_atomic_t signaled = 0;
+
+static void
+onSignal(int signum)
+{
+	signaled = signum;
+}
+
+static long long
+nowUs()
+{
+	return chrono::duration_cast<chrono::microseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+EventLoop::EventLoop() : spin(0), epollFd(0), signalFd(-1)
+{
+}
+
+EventLoop::~EventLoop()
+{
+}
+
+bool
+EventLoop::isValid() const
+{
+	return true;
+}
+
+bool
+EventLoop::watch(int fd, int id)
+{
+	// level-triggered, which also satisfies the edge-triggered contract
+#ifdef WIN32
+	u_long nonBlocking = 1;
+	if (ioctlsocket(fd, FIONBIO, &nonBlocking) != 0)
+		return false;
+#else
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		return false;
+#endif
+	fds.push_back(fd);
+	fdIds.push_back(id);
+	return true;
+}
+
+bool
+EventLoop::addTimer(int id)
+{
+	if (id < 0)
+		return false;
+	if ((size_t) id >= deadlines.size())
+		deadlines.resize(id+1, -1);
+	return true;
+}
+
+void
+EventLoop::arm(int id, long usec)
+{
+	deadlines[id] = usec > 0 ? nowUs() + usec : -1;
+}
+
+bool
+EventLoop::catchSignals()
+{
+	signalFd = 0;
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+#ifdef SIGUSR1
+	signal(SIGUSR1, onSignal);
+#endif
+	return true;
+}
+
+int
+EventLoop::wait(tevent *events, int max)
+{
+	while (1)
+	{
+		int n = 0;
+		long long now = nowUs(), next = -1;
+		if (signaled && n < max)
+		{
+			events[n].kind = SIGNALED;
+			events[n++].id = signaled;
+			signaled = 0;
+		}
+		for (size_t i = 0; i < deadlines.size() && n < max; i++)
+		{
+			if (deadlines[i] < 0)
+				continue;
+			if (deadlines[i] <= now)
+			{
+				deadlines[i] = -1;
+				events[n].kind = TIMEOUT;
+				events[n++].id = i;
+			}
+			else if (next < 0 || deadlines[i] < next)
+				next = deadlines[i];
+		}
+		if (n > 0)
+			return n;
+
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		int maxFd = 0;
+		for (size_t i = 0; i < fds.size(); i++)
+		{
+			FD_SET(fds[i], &readSet);
+			if (fds[i] > maxFd)
+				maxFd = fds[i];
+		}
+		struct timeval timeVal, *timeout = NULL;
+		if (next >= 0)
+		{
+			timeVal.tv_sec = (next - now) / 1000000;
+			timeVal.tv_usec = (next - now) % 1000000;
+			timeout = &timeVal;
+		}
+		int ready = select(maxFd+1, &readSet, NULL, NULL, timeout);
+		if (ready < 0 && errno != EINTR)
+			return -1;
+		for (size_t i = 0; ready > 0 && i < fds.size() && n < max; i++)
+			if (FD_ISSET(fds[i], &readSet))
+			{
+				events[n].kind = READABLE;
+				events[n++].id = fdIds[i];
+			}
+		if (n > 0)
+			return n;
+	}
+}
+
+#endif
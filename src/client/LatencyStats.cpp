@@ -0,0 +1,99 @@
+/***************************************************************************
+
+    file                 : LatencyStats.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "LatencyStats.h"
+
+#include <cstdio>
+#include <cstring>
+
+const int LatencyHistogram::SUB_BUCKETS;
+const int LatencyHistogram::BUCKETS_NUM;
+
+const char *LatencyStats::PHASE_NAMES[LatencyStats::PHASES_NUM] =
+	{"queue", "receive", "parse", "transition", "drive", "serialize", "send", "tick", "wakeup", "restart"};
+
+void
+LatencyHistogram::clear()
+{
+	memset(counts, 0, sizeof(counts));
+	total = 0;
+	sum = 0;
+	maxValue = 0;
+}
+
+void
+LatencyHistogram::add(const LatencyHistogram &other)
+{
+	for (int i = 0; i < BUCKETS_NUM; i++)
+		counts[i] += other.counts[i];
+	total += other.total;
+	sum += other.sum;
+	if (other.maxValue > maxValue)
+		maxValue = other.maxValue;
+}
+
+long long
+LatencyHistogram::upperBound(int bucket)
+{
+	if (bucket < SUB_BUCKETS)
+		return bucket;
+	int octave = bucket/SUB_BUCKETS + 3;
+	long long lower = (long long) (SUB_BUCKETS + bucket%SUB_BUCKETS) << (octave-4);
+	return lower + (1LL << (octave-4)) - 1;
+}
+
+long long
+LatencyHistogram::percentile(double fraction) const
+{
+	if (total == 0)
+		return 0;
+	unsigned long rank = (unsigned long) (fraction * total);
+	if (rank >= total)
+		rank = total - 1;
+	unsigned long seen = 0;
+	for (int i = 0; i < BUCKETS_NUM; i++)
+	{
+		seen += counts[i];
+		if (seen > rank)
+			return upperBound(i) < maxValue ? upperBound(i) : maxValue;
+	}
+	return maxValue;
+}
+
+void
+LatencyStats::print(ostream &out) const
+{
+	char line[160];
+	snprintf(line, sizeof(line), "%-11s %10s %9s %9s %9s %9s %9s %9s",
+	         "phase (us)", "count", "mean", "p50", "p90", "p99", "p999", "max");
+	out << line << endl;
+	for (int i = 0; i < PHASES_NUM; i++)
+	{
+		const LatencyHistogram &h = phases[i];
+		if (h.count() == 0)
+			continue;
+		snprintf(line, sizeof(line), "%-11s %10lu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f",
+		         PHASE_NAMES[i], h.count(), h.mean()/1e3, h.percentile(0.5)/1e3,
+		         h.percentile(0.9)/1e3, h.percentile(0.99)/1e3, h.percentile(0.999)/1e3,
+		         h.max()/1e3);
+		out << line << endl;
+	}
+}
+
+void
+LatencyStats::clear()
+{
+	for (int i = 0; i < PHASES_NUM; i++)
+		phases[i].clear();
+}
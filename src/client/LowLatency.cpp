@@ -0,0 +1,121 @@
+/***************************************************************************
+
+    file                 : LowLatency.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "LowLatency.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#endif
+
+const long LowLatency::DEFAULT_SPIN;
+const int LowLatency::DEFAULT_FIFO_PRIORITY;
+
+bool
+LowLatency::parse(const char *value)
+{
+	enabled = true;
+	cpu = -1;
+	fifoPriority = 0;
+	spin = DEFAULT_SPIN;
+
+	char *end;
+	cpu = strtol(value, &end, 10);
+	if (end == value)
+		return false;
+	while (*end == ',')
+	{
+		const char *item = end+1;
+		if (strncmp(item, "fifo", 4) == 0)
+		{
+			end = (char *) item+4;
+			fifoPriority = DEFAULT_FIFO_PRIORITY;
+			if (*end == '=')
+				fifoPriority = strtol(end+1, &end, 10);
+		}
+		else if (strncmp(item, "spin=", 5) == 0)
+			spin = strtol(item+5, &end, 10);
+		else
+			return false;
+	}
+	return *end == '\0' && spin >= 0;
+}
+
+bool
+LowLatency::apply(int socket, ostream &log) const
+{
+#ifdef __linux__
+	bool applied = true;
+
+	if (cpu >= 0)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0)
+		{
+			log << "cannot pin to cpu " << cpu << ": " << strerror(errno) << endl;
+			applied = false;
+		}
+	}
+
+	if (fifoPriority > 0)
+	{
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = fifoPriority;
+		if (sched_setscheduler(0, SCHED_FIFO, &param) < 0)
+		{
+			log << "cannot use SCHED_FIFO: " << strerror(errno) << endl;
+			applied = false;
+		}
+	}
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+	{
+		log << "cannot lock memory: " << strerror(errno) << endl;
+		applied = false;
+	}
+
+#ifdef SO_BUSY_POLL
+	int busyPoll = spin;
+	if (socket >= 0 && spin > 0
+	    && setsockopt(socket, SOL_SOCKET, SO_BUSY_POLL, &busyPoll, sizeof(busyPoll)) < 0)
+	{
+		// needs CAP_NET_ADMIN; the spin of the client works without it
+		log << "cannot busy poll the socket: " << strerror(errno) << endl;
+		applied = false;
+	}
+#endif
+	return applied;
+#else
+	log << "lowlatency is only supported on Linux" << endl;
+	return false;
+#endif
+}
+
+void
+LowLatency::print(ostream &out) const
+{
+	out << "cpu " << cpu;
+	if (fifoPriority > 0)
+		out << ", SCHED_FIFO " << fifoPriority;
+	out << ", mlockall, spin " << spin << " us";
+}
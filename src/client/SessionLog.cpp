@@ -0,0 +1,132 @@
+/***************************************************************************
+
+    file                 : SessionLog.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "SessionLog.h"
+
+#include <cstring>
+#include "LatencyStats.h"
+
+const char SessionLog::MAGIC[8] = {'S','C','R','L','O','G','\0','\1'};
+const size_t SessionLog::RECORD_HEADER_LEN;
+
+static const size_t BUFFER_LEN = 1 << 20;
+
+static void
+putLE(char *p, unsigned long long value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+		p[i] = (char) (value >> (8*i));
+}
+
+static unsigned long long
+getLE(const char *p, int bytes)
+{
+	unsigned long long value = 0;
+	for (int i = 0; i < bytes; i++)
+		value |= (unsigned long long) (unsigned char) p[i] << (8*i);
+	return value;
+}
+
+bool
+SessionRecorder::open(const char *path, const char *id, const char *trackName, int stage)
+{
+	close();
+	file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	buffer.resize(BUFFER_LEN);
+	setvbuf(file, &buffer[0], _IOFBF, buffer.size());
+	start = LatencyStats::now();
+
+	char header[1200];
+	int len = snprintf(header, sizeof(header), "id:%s track:%s stage:%d", id, trackName, stage);
+	if (fwrite(SessionLog::MAGIC, sizeof(SessionLog::MAGIC), 1, file) != 1 || len < 0)
+	{
+		close();
+		return false;
+	}
+	record(SessionLog::HEADER, header, len);
+	return true;
+}
+
+void
+SessionRecorder::record(SessionLog::tlogtype type, const char *data, size_t len)
+{
+	if (file == NULL)
+		return;
+	char head[SessionLog::RECORD_HEADER_LEN];
+	head[0] = (char) type;
+	putLE(head+1, len, 4);
+	putLE(head+5, LatencyStats::now() - start, 8);
+	fwrite(head, sizeof(head), 1, file);
+	fwrite(data, 1, len, file);
+}
+
+void
+SessionRecorder::close()
+{
+	if (file != NULL)
+		fclose(file);
+	file = NULL;
+}
+
+bool
+SessionReader::load(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+	bytes.clear();
+	char chunk[65536];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		bytes.insert(bytes.end(), chunk, chunk + n);
+	fclose(file);
+
+	const size_t magicLen = sizeof(SessionLog::MAGIC);
+	if (bytes.size() < magicLen || memcmp(&bytes[0], SessionLog::MAGIC, magicLen) != 0)
+		return false;
+
+	id = trackName = "";
+	stage = 0;
+	records.clear();
+	size_t p = magicLen;
+	while (p + SessionLog::RECORD_HEADER_LEN <= bytes.size())
+	{
+		trecord record;
+		record.type = (SessionLog::tlogtype) bytes[p];
+		record.len = getLE(&bytes[p+1], 4);
+		record.time = getLE(&bytes[p+5], 8);
+		record.offset = p + SessionLog::RECORD_HEADER_LEN;
+		if (record.offset + record.len > bytes.size())
+			break;
+		p = record.offset + record.len;
+
+		if (record.type == SessionLog::HEADER)
+		{
+			string header(data(record), record.len);
+			char value[1024];
+			size_t at;
+			if ((at = header.find("id:")) != string::npos && sscanf(header.c_str()+at, "id:%1023s", value) == 1)
+				id = value;
+			if ((at = header.find("track:")) != string::npos && sscanf(header.c_str()+at, "track:%1023s", value) == 1)
+				trackName = value;
+			if ((at = header.find("stage:")) != string::npos)
+				sscanf(header.c_str()+at, "stage:%d", &stage);
+		}
+		else
+			records.push_back(record);
+	}
+	return true;
+}
@@ -15,6 +15,11 @@
  ***************************************************************************/
 #include "SimpleParser.h"
 
+#include <stdint.h>
+#include <cmath>
+
+const int SimpleParser::MAX_NUMBER_LEN;
+
 bool
 SimpleParser::parse(string sensors, string tag, float &value)
 {
@@ -126,3 +131,415 @@ SimpleParser::stringify(string tag, float *value, int size)
 	STR << ")";
 	return STR.str();
 }
+
+static inline bool
+isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool
+isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// Exactly representable powers of ten used to scale the decimal mantissa.
+static const double POW10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static double
+scale(double value, int exp10)
+{
+	while (exp10 > 22)
+	{
+		value *= POW10[22];
+		exp10 -= 22;
+	}
+	while (exp10 < -22)
+	{
+		value /= POW10[22];
+		exp10 += 22;
+	}
+	return exp10 < 0 ? value / POW10[-exp10] : value * POW10[exp10];
+}
+
+bool
+SimpleParser::nextGroup(const char *&p, const char *end,
+                        const char *&tag, size_t &tagLen,
+                        const char *&values, const char *&valuesEnd)
+{
+	const char *open = (const char *) memchr(p, '(', end - p);
+	if (open == NULL)
+	{
+		p = end;
+		return false;
+	}
+	const char *close = (const char *) memchr(open + 1, ')', end - open - 1);
+	if (close == NULL)
+	{
+		p = end;
+		return false;
+	}
+
+	tag = open + 1;
+	while (tag < close && isBlank(*tag))
+		++tag;
+	values = tag;
+	while (values < close && !isBlank(*values))
+		++values;
+	tagLen = values - tag;
+	valuesEnd = close;
+	p = close + 1;
+	return true;
+}
+
+bool
+SimpleParser::parseValue(const char *&p, const char *end, float &value)
+{
+	const char *s = p;
+	while (s < end && isBlank(*s))
+		++s;
+
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+'))
+		negative = (*s++ == '-');
+
+	// Keep up to 19 significant digits in an integer mantissa, the rest only
+	// moves the decimal exponent.
+	uint64_t mantissa = 0;
+	int digits = 0, exp10 = 0;
+	bool any = false;
+	for (; s < end && isDigit(*s); ++s, any = true)
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa*10 + (*s - '0');
+			if (mantissa)
+				++digits;
+		}
+		else
+			++exp10;
+	}
+	if (s < end && *s == '.')
+	{
+		for (++s; s < end && isDigit(*s); ++s, any = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa*10 + (*s - '0');
+				if (mantissa)
+					++digits;
+				--exp10;
+			}
+		}
+	}
+	if (!any)
+		return false;
+
+	if (s < end && (*s == 'e' || *s == 'E'))
+	{
+		const char *e = s + 1;
+		bool negativeExp = false;
+		if (e < end && (*e == '-' || *e == '+'))
+			negativeExp = (*e++ == '-');
+		if (e < end && isDigit(*e))
+		{
+			int exponent = 0;
+			for (; e < end && isDigit(*e); ++e)
+				if (exponent < 10000)
+					exponent = exponent*10 + (*e - '0');
+			exp10 += negativeExp ? -exponent : exponent;
+			s = e;
+		}
+	}
+
+	double result = scale((double) mantissa, exp10);
+	value = (float) (negative ? -result : result);
+	p = s;
+	return true;
+}
+
+bool
+SimpleParser::parseValue(const char *&p, const char *end, int &value)
+{
+	const char *s = p;
+	while (s < end && isBlank(*s))
+		++s;
+
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+'))
+		negative = (*s++ == '-');
+	if (s == end || !isDigit(*s))
+		return false;
+
+	long result = 0;
+	for (; s < end && isDigit(*s); ++s)
+		if (result < 100000000000L)
+			result = result*10 + (*s - '0');
+	// Like "IN >> value", a fractional part is left out of the integer, but
+	// it is skipped here so the next value starts on a fresh token.
+	while (s < end && !isBlank(*s))
+		++s;
+
+	value = (int) (negative ? -result : result);
+	p = s;
+	return true;
+}
+
+bool
+SimpleParser::parseValues(const char *p, const char *end, float *value, int size)
+{
+	for (int i = 0; i < size; ++i)
+	{
+		if (!parseValue(p, end, value[i]))
+			return false;
+	}
+	return true;
+}
+
+int
+SimpleParser::format(char *buf, int value)
+{
+	char digits[12];
+	int n = 0;
+	char *out = buf;
+	unsigned int v = value;
+	if (value < 0)
+	{
+		*out++ = '-';
+		v = 0u - v;
+	}
+	do
+	{
+		digits[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	while (n)
+		*out++ = digits[--n];
+	return out - buf;
+}
+
+int
+SimpleParser::format(char *buf, float value)
+{
+	char *out = buf;
+	double v = value;
+
+	if (v != v)
+	{
+		memcpy(out, "nan", 3);
+		return 3;
+	}
+	if (signbit(v))
+	{
+		*out++ = '-';
+		v = -v;
+	}
+	if (v == 0)
+	{
+		*out++ = '0';
+		return out - buf;
+	}
+	if (v > 3.5e38)
+	{
+		memcpy(out, "inf", 3);
+		return out - buf + 3;
+	}
+
+	// Decimal exponent of the leading digit, then the 6 significant digits
+	// rounded to nearest, ties to even (as printf does).
+	int exp10 = 0;
+	while (exp10 < 38 && v >= scale(1, exp10 + 1))
+		++exp10;
+	while (exp10 > -46 && v < scale(1, exp10))
+		--exp10;
+	double scaled = scale(v, 5 - exp10);
+	uint64_t mantissa = (uint64_t) scaled;
+	double rest = scaled - mantissa;
+	if (rest > 0.5 || (rest == 0.5 && (mantissa & 1)))
+		++mantissa;
+	if (mantissa >= 1000000)
+	{
+		mantissa /= 10;
+		++exp10;
+	}
+
+	char digits[6];
+	for (int i = 5; i >= 0; --i)
+	{
+		digits[i] = '0' + mantissa % 10;
+		mantissa /= 10;
+	}
+	int last = 5;
+	while (last > 0 && digits[last] == '0')
+		--last;
+
+	if (exp10 < -4 || exp10 >= 6)
+	{
+		*out++ = digits[0];
+		if (last > 0)
+		{
+			*out++ = '.';
+			for (int i = 1; i <= last; ++i)
+				*out++ = digits[i];
+		}
+		*out++ = 'e';
+		*out++ = exp10 < 0 ? '-' : '+';
+		int e = exp10 < 0 ? -exp10 : exp10;
+		if (e < 10)
+			*out++ = '0';
+		out += format(out, e);
+	}
+	else if (exp10 >= 0)
+	{
+		for (int i = 0; i <= exp10; ++i)
+			*out++ = digits[i];
+		if (last > exp10)
+		{
+			*out++ = '.';
+			for (int i = exp10 + 1; i <= last; ++i)
+				*out++ = digits[i];
+		}
+	}
+	else
+	{
+		*out++ = '0';
+		*out++ = '.';
+		for (int i = -1; i > exp10; --i)
+			*out++ = '0';
+		for (int i = 0; i <= last; ++i)
+			*out++ = digits[i];
+	}
+	return out - buf;
+}
+
+// Appends "(tag" to buf, checking there is room for the tag, n values and
+// the closing ")\0".
+static char *
+openGroup(char *buf, size_t size, const char *tag, int n)
+{
+	size_t tagLen = strlen(tag);
+	if (size < 1 + tagLen + n*(1 + SimpleParser::MAX_NUMBER_LEN) + 2)
+		return NULL;
+	*buf++ = '(';
+	memcpy(buf, tag, tagLen);
+	return buf + tagLen;
+}
+
+static int
+closeGroup(char *begin, char *out)
+{
+	*out++ = ')';
+	*out = '\0';
+	return out - begin;
+}
+
+int
+SimpleParser::stringify(char *buf, size_t size, const char *tag, float value)
+{
+	char *out = openGroup(buf, size, tag, 1);
+	if (out == NULL)
+		return -1;
+	*out++ = ' ';
+	out += format(out, value);
+	return closeGroup(buf, out);
+}
+
+int
+SimpleParser::stringify(char *buf, size_t size, const char *tag, int value)
+{
+	char *out = openGroup(buf, size, tag, 1);
+	if (out == NULL)
+		return -1;
+	*out++ = ' ';
+	out += format(out, value);
+	return closeGroup(buf, out);
+}
+
+int
+SimpleParser::stringify(char *buf, size_t size, const char *tag, const float *value, int n)
+{
+	char *out = openGroup(buf, size, tag, n);
+	if (out == NULL)
+		return -1;
+	for (int i = 0; i < n; ++i)
+	{
+		*out++ = ' ';
+		out += format(out, value[i]);
+	}
+	return closeGroup(buf, out);
+}
+
+bool
+SimpleParser::parseField(const MessageField &field, void *object, const char *p, const char *end)
+{
+	char *base = (char *) object + field.offset;
+	if (field.type == FIELD_FLOAT)
+		return parseValues(p, end, (float *) base, field.arity);
+
+	return parseValue(p, end, *(int *) base);
+}
+
+unsigned long
+SimpleParser::parse(const MessageSchema &schema, void *object, const char *msg, size_t len)
+{
+	const char *p = msg, *end = msg + len;
+	const char *tag, *values, *valuesEnd;
+	size_t tagLen;
+	unsigned long found = 0;
+
+	while (nextGroup(p, end, tag, tagLen, values, valuesEnd))
+	{
+		int i = schema.find(tag, tagLen);
+		if (i >= 0 && parseField(schema.fields[i], object, values, valuesEnd))
+			found |= 1ul << i;
+	}
+	return found;
+}
+
+unsigned long
+SimpleParser::index(const MessageSchema &schema, const char *msg, size_t len,
+                    unsigned short *begin, unsigned short *end)
+{
+	const char *p = msg, *msgEnd = msg + len;
+	const char *tag, *values, *valuesEnd;
+	size_t tagLen;
+	unsigned long found = 0;
+
+	while (nextGroup(p, msgEnd, tag, tagLen, values, valuesEnd))
+	{
+		int i = schema.find(tag, tagLen);
+		if (i >= 0)
+		{
+			begin[i] = values - msg;
+			end[i] = valuesEnd - msg;
+			found |= 1ul << i;
+		}
+	}
+	return found;
+}
+
+int
+SimpleParser::stringify(const MessageSchema &schema, const void *object, char *buf, size_t size)
+{
+	char *out = buf;
+	char *end = buf + size;
+
+	for (int i = 0; i < schema.size; ++i)
+	{
+		const MessageField &field = schema.fields[i];
+		const char *base = (const char *) object + field.offset;
+		int n;
+		if (field.type == FIELD_FLOAT)
+			n = stringify(out, end - out, field.tag, (const float *) base, field.arity);
+		else
+			n = stringify(out, end - out, field.tag, *(const int *) base);
+		if (n < 0)
+			return -1;
+		out += n;
+	}
+	return out - buf;
+}
@@ -0,0 +1,349 @@
+/***************************************************************************
+
+    file                 : UringSocket.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "UringSocket.h"
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+// user_data of the completions: sends carry their slot
+static const unsigned long long RECEIVE_TAG = 1ULL << 62;
+static const unsigned long long SEND_TAG = 1ULL << 63;
+
+static const unsigned short BUFFER_GROUP = 0;
+
+// The rings are shared with the kernel: its writes are read with acquire
+// and ours published with release.
+static unsigned int
+loadAcquire(const unsigned int *p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static void
+storeRelease(unsigned int *p, unsigned int value)
+{
+	__atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+static unsigned int
+powerOfTwo(unsigned int n)
+{
+	unsigned int p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
+
+UringSocket::UringSocket(int socket, unsigned int buffers, size_t len, bool stamped, bool sqpoll)
+	: valid(false), socket(socket), ringFd(-1), sqpoll(sqpoll), maxLen(len),
+	  sqMem(MAP_FAILED), sqMemLen(0), sqes((struct io_uring_sqe *) MAP_FAILED), sqesLen(0),
+	  sqLocalTail(0), bufRing((struct io_uring_buf *) MAP_FAILED), bufRingLen(0),
+	  bufEntries(powerOfTwo(buffers < 8 ? 8 : buffers)), receiving(false),
+	  syscalls(0), sendErrors(0), truncated(0)
+{
+	if (bufEntries > 32768)
+		bufEntries = 32768;
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	// every buffer and every send slot may have a completion queued
+	params.cq_entries = 4*bufEntries;
+	if (sqpoll)
+	{
+		params.flags |= IORING_SETUP_SQPOLL;
+		params.sq_thread_idle = 1000;   // ms before the thread sleeps
+	}
+	ringFd = syscall(__NR_io_uring_setup, bufEntries, &params);
+	if (ringFd < 0 || !(params.features & IORING_FEAT_SINGLE_MMAP))
+		return;
+
+	// the submission and completion rings share one mapping
+	sqMemLen = params.sq_off.array + params.sq_entries*sizeof(unsigned int);
+	size_t cqLen = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+	if (cqLen > sqMemLen)
+		sqMemLen = cqLen;
+	sqMem = mmap(NULL, sqMemLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	             ringFd, IORING_OFF_SQ_RING);
+	sqesLen = params.sq_entries*sizeof(struct io_uring_sqe);
+	sqes = (struct io_uring_sqe *) mmap(NULL, sqesLen, PROT_READ | PROT_WRITE,
+	                                    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+	if (sqMem == MAP_FAILED || sqes == MAP_FAILED)
+		return;
+	char *base = (char *) sqMem;
+	sqHead = (unsigned int *) (base + params.sq_off.head);
+	sqTail = (unsigned int *) (base + params.sq_off.tail);
+	sqMask = (unsigned int *) (base + params.sq_off.ring_mask);
+	sqFlags = (unsigned int *) (base + params.sq_off.flags);
+	sqArray = (unsigned int *) (base + params.sq_off.array);
+	sqLocalTail = *sqTail;
+	cqHead = (unsigned int *) (base + params.cq_off.head);
+	cqTail = (unsigned int *) (base + params.cq_off.tail);
+	cqMask = (unsigned int *) (base + params.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe *) (base + params.cq_off.cqes);
+
+	// A received buffer holds the recvmsg header, the source address, the
+	// control messages and the payload, with room for a '\0'
+	memset(&recvHdr, 0, sizeof(recvHdr));
+	recvHdr.msg_namelen = sizeof(struct sockaddr_in);
+	recvHdr.msg_controllen = stamped ? CMSG_SPACE(sizeof(struct timespec)) : 0;
+	bufLen = sizeof(struct io_uring_recvmsg_out) + recvHdr.msg_namelen
+	         + recvHdr.msg_controllen + maxLen + 1;
+	this->buffers.resize(bufEntries*bufLen);
+
+	bufRingLen = bufEntries*sizeof(struct io_uring_buf);
+	bufRing = (struct io_uring_buf *) mmap(NULL, bufRingLen, PROT_READ | PROT_WRITE,
+	                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bufRing == MAP_FAILED)
+		return;
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (unsigned long long) bufRing;
+	reg.ring_entries = bufEntries;
+	reg.bgid = BUFFER_GROUP;
+	if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+		return;
+	for (unsigned int i = 0; i < bufEntries; i++)
+	{
+		bufRing[i].addr = (unsigned long long) &this->buffers[i*bufLen];
+		bufRing[i].len = bufLen - 1;
+		bufRing[i].bid = i;
+	}
+	// the tail of the buffer ring overlays the reserved field of its first entry
+	__atomic_store_n(&bufRing[0].resv, (unsigned short) bufEntries, __ATOMIC_RELEASE);
+
+	// as many send slots as submission entries, so the ring never overflows
+	slots.resize(params.sq_entries);
+	slotData.resize(params.sq_entries*maxLen);
+	for (unsigned int i = 0; i < slots.size(); i++)
+	{
+		tslot &slot = slots[i];
+		memset(&slot.hdr, 0, sizeof(slot.hdr));
+		slot.iov.iov_base = &slotData[i*maxLen];
+		slot.hdr.msg_name = &slot.to;
+		slot.hdr.msg_namelen = sizeof(slot.to);
+		slot.hdr.msg_iov = &slot.iov;
+		slot.hdr.msg_iovlen = 1;
+		freeSlots.push_back(slots.size() - 1 - i);
+	}
+
+	postReceive();
+	valid = submit();
+}
+
+UringSocket::~UringSocket()
+{
+	if (bufRing != MAP_FAILED)
+		munmap(bufRing, bufRingLen);
+	if (sqes != MAP_FAILED)
+		munmap(sqes, sqesLen);
+	if (sqMem != MAP_FAILED)
+		munmap(sqMem, sqMemLen);
+	if (ringFd >= 0)
+		close(ringFd);
+}
+
+int
+UringSocket::enter(unsigned int submit, unsigned int wait, unsigned int flags)
+{
+	syscalls++;
+	int n;
+	do
+		n = syscall(__NR_io_uring_enter, ringFd, submit, wait, flags, NULL, 0);
+	while (n < 0 && errno == EINTR);
+	return n;
+}
+
+struct io_uring_sqe *
+UringSocket::nextSqe()
+{
+	if (sqLocalTail - loadAcquire(sqHead) > *sqMask)
+	{
+		// full: hand the ring to the kernel first (the polling thread
+		// takes it in its own time)
+		if (!submit())
+			return NULL;
+		if (sqpoll && sqLocalTail - loadAcquire(sqHead) > *sqMask)
+			enter(0, 0, IORING_ENTER_SQ_WAIT);
+		if (sqLocalTail - loadAcquire(sqHead) > *sqMask)
+			return NULL;
+	}
+	unsigned int index = sqLocalTail & *sqMask;
+	struct io_uring_sqe *sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqArray[index] = index;
+	sqLocalTail++;
+	return sqe;
+}
+
+void
+UringSocket::postReceive()
+{
+	struct io_uring_sqe *sqe = nextSqe();
+	if (sqe == NULL)
+		return;
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = socket;
+	sqe->addr = (unsigned long long) &recvHdr;
+	sqe->len = 1;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = BUFFER_GROUP;
+	sqe->user_data = RECEIVE_TAG;
+	receiving = true;
+}
+
+bool
+UringSocket::submit()
+{
+	unsigned int n = sqLocalTail - *sqTail;
+	if (n == 0)
+		return true;
+	storeRelease(sqTail, sqLocalTail);
+	if (sqpoll)
+	{
+		// the kernel thread takes them, unless it went to sleep
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (loadAcquire(sqFlags) & IORING_SQ_NEED_WAKEUP)
+			return enter(0, 0, IORING_ENTER_SQ_WAKEUP) >= 0;
+		return true;
+	}
+	return enter(n, 0, 0) >= 0;
+}
+
+bool
+UringSocket::reap()
+{
+	bool ok = true;
+	unsigned int head = *cqHead, tail = loadAcquire(cqTail);
+	for (; head != tail; head++)
+	{
+		const struct io_uring_cqe &cqe = cqes[head & *cqMask];
+		if (cqe.user_data & SEND_TAG)
+		{
+			if (cqe.res < 0)
+				sendErrors++;
+			freeSlots.push_back(cqe.user_data & ~SEND_TAG);
+			continue;
+		}
+
+		// the multishot receive ends when it runs out of buffers (it is
+		// posted again once they are released) or on a socket error
+		if (!(cqe.flags & IORING_CQE_F_MORE))
+			receiving = false;
+		if (cqe.res < 0)
+		{
+			if (cqe.res != -ENOBUFS)
+				ok = false;
+			continue;
+		}
+		if (!(cqe.flags & IORING_CQE_F_BUFFER))
+			continue;
+
+		tmessage msg;
+		msg.buffer = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+		char *buf = &buffers[msg.buffer*bufLen];
+		struct io_uring_recvmsg_out out;
+		memcpy(&out, buf, sizeof(out));
+		size_t offset = sizeof(out) + recvHdr.msg_namelen + recvHdr.msg_controllen;
+		msg.from = (const struct sockaddr_in *) (buf + sizeof(out));
+		msg.data = buf + offset;
+		msg.len = out.payloadlen;
+		if ((size_t) cqe.res < offset + msg.len)
+		{
+			truncated++;
+			msg.len = cqe.res > (int) offset ? cqe.res - offset : 0;
+		}
+		msg.data[msg.len] = '\0';
+
+		msg.stamp = 0;
+		if (out.controllen > 0)
+		{
+			struct msghdr hdr;
+			memset(&hdr, 0, sizeof(hdr));
+			hdr.msg_control = buf + sizeof(out) + recvHdr.msg_namelen;
+			hdr.msg_controllen = out.controllen;
+			for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+				if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+				{
+					struct timespec ts;
+					memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+					msg.stamp = ts.tv_sec*1000000000LL + ts.tv_nsec;
+				}
+		}
+		received.push_back(msg);
+	}
+	storeRelease(cqHead, head);
+	return ok;
+}
+
+void
+UringSocket::release()
+{
+	if (!received.empty())
+	{
+		unsigned short tail = __atomic_load_n(&bufRing[0].resv, __ATOMIC_RELAXED);
+		for (size_t i = 0; i < received.size(); i++, tail++)
+		{
+			struct io_uring_buf &entry = bufRing[tail & (bufEntries - 1)];
+			unsigned short bid = received[i].buffer;
+			entry.addr = (unsigned long long) &buffers[bid*bufLen];
+			entry.len = bufLen - 1;
+			entry.bid = bid;
+		}
+		__atomic_store_n(&bufRing[0].resv, tail, __ATOMIC_RELEASE);
+		received.clear();
+	}
+	if (!receiving)
+		postReceive();
+}
+
+bool
+UringSocket::send(const struct sockaddr_in &to, const char *data, size_t len)
+{
+	if (len > maxLen)
+		return false;
+	while (freeSlots.empty())
+	{
+		// every slot is in flight: wait for a send to finish
+		if (!submit() || enter(0, 1, IORING_ENTER_GETEVENTS) < 0 || !reap())
+			return false;
+	}
+	unsigned int index = freeSlots.back();
+	tslot &slot = slots[index];
+	struct io_uring_sqe *sqe = nextSqe();
+	if (sqe == NULL)
+		return false;
+	freeSlots.pop_back();
+	memcpy(slot.iov.iov_base, data, len);
+	slot.iov.iov_len = len;
+	slot.to = to;
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = socket;
+	sqe->addr = (unsigned long long) &slot.hdr;
+	sqe->len = 1;
+	sqe->user_data = SEND_TAG | index;
+	return true;
+}
+
+#endif /*__linux__*/
@@ -23,4 +23,36 @@ WrapperBaseDriver::drive(string sensors)
 	return cc.toString();	
 }
 
+int
+WrapperBaseDriver::drive(const char *sensors, size_t len, char *action, size_t size)
+{
+	long long start = LatencyStats::now();
+	CarState cs(sensors, len, lazyState);
+	long long parsed = LatencyStats::now();
+	latency.record(LatencyStats::PARSE, parsed - start);
+
+	CarControl cc = wDrive(cs);
+	lastControl = cc;
+
+	// answer in the encoding the sensors came in
+	long long driven = LatencyStats::now();
+	int actionLen;
+	lastBinary = BinaryParser::isBinary(sensors, len, BinaryParser::BINARY_SENSORS);
+	if (lastBinary)
+		actionLen = cc.toBinary(action, size);
+	else
+		actionLen = cc.toString(action, size);
+	latency.record(LatencyStats::SERIALIZE, LatencyStats::now() - driven);
+	return actionLen;
+}
 
+
+
+int
+WrapperBaseDriver::fallback(char *action, size_t size)
+{
+	CarControl cc = fallbackControl(lastControl);
+	if (lastBinary)
+		return cc.toBinary(action, size);
+	return cc.toString(action, size);
+}
@@ -25,15 +25,29 @@
 #include <netinet/in.h>
 #include <unistd.h>
 #endif
+#ifdef __linux__
+#include <sys/socket.h>
+#include <vector>
+#endif
 
 #include <iostream>
 #include <cstdlib>
 #include <cstdio>
+#include <cerrno>
+#include <csignal>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include "CarSession.h"
+#include "EventLoop.h"
+#include "LowLatency.h"
+#include "UringSocket.h"
 #include __DRIVER_INCLUDE__
 
 /*** defines for UDP *****/
 #define UDP_MSGLEN 1000
 #define UDP_CLIENT_TIMEUOT 1000000
+#define UDP_CLIENT_RETRY 20000
 //#define __UDP_CLIENT_VERBOSE__
 /************************/
 
@@ -41,16 +55,35 @@
 typedef sockaddr_in tSockAddrIn;
 #define CLOSE(x) closesocket(x)
 #define INVALID(x) x == INVALID_SOCKET
+#define DRAINED() (WSAGetLastError() == WSAEWOULDBLOCK)
 #else
 typedef int SOCKET;
 typedef struct sockaddr_in tSockAddrIn;
 #define CLOSE(x) close(x)
 #define INVALID(x) x < 0
+#define DRAINED() (errno == EAGAIN || errno == EWOULDBLOCK)
 #endif
 
 class __DRIVER_CLASS__;
 typedef __DRIVER_CLASS__ tDriver;
 
+/*** client options (besides the SCR ones) ***/
+typedef struct
+{
+    bool lazyState;     // lazy:1 decodes each sensor only when read
+    bool binaryWire;    // wire:binary asks the server for binary messages
+    unsigned int lastPort; // port:3001-3010 drives one car per port
+    bool kernelTimestamps; // timestamps:1 measures the time spent in the socket
+    long budget;        // budget:<us> sends a fallback when the driver is late
+    LowLatency lowLatency; // lowlatency:<cpu>[,fifo[=prio]][,spin=<us>]
+    const char *recordPath; // record:<file> logs the session for replay
+    bool freshest;      // fresh:1 drives only on the newest queued sensors
+    bool uring, sqpoll; // backend:uring[,sqpoll] moves datagrams through io_uring
+    long retryFirst, retryMax; // retry:<us>-<us> backs the identification off
+    bool watchFiles;    // watch:1 lets the driver pick up edits of its files
+    const char *tracePath; // trace:<file> dumps the driver's trace on SIGUSR1 and at the end
+} tClientOptions;
+
 
 using namespace std;
 
@@ -58,6 +91,18 @@ using namespace std;
 //		bool &noise, double &noiseAVG, double &noiseSTD, long &seed, char *trackName, BaseDriver::tstage &stage);
 void parse_args(int argc, char *argv[], char *hostName, unsigned int &serverPort, char *id, unsigned int &maxEpisodes,
 		  unsigned int &maxSteps, char *trackName, BaseDriver::tstage &stage);
+void parse_client_options(int argc, char *argv[], tClientOptions &options);
+void print_jitter(const LatencyHistogram &wakeups);
+void dump_trace(BaseDriver &driver, const char *path, unsigned int port);
+long long now_us();
+int recv_message(SOCKET socketDescriptor, char *buf, bool stamped, long long &stamp);
+#ifdef __linux__
+long long realtime_ns();
+int recv_stamped(SOCKET socketDescriptor, char *buf, size_t len, long long &stamp);
+int run_cars(SOCKET socketDescriptor, const tSockAddrIn &serverAddress, unsigned int firstPort,
+             unsigned int lastPort, const char *id, unsigned int maxEpisodes, unsigned int maxSteps,
+             const char *trackName, BaseDriver::tstage stage, const tClientOptions &options);
+#endif
 
 int main(int argc, char *argv[])
 {
@@ -75,12 +120,13 @@ int main(int argc, char *argv[])
 //    long seed;
     char trackName[1000];
     BaseDriver::tstage stage;
+    tClientOptions options;
 
     tSockAddrIn serverAddress;
     struct hostent *hostInfo;
-    struct timeval timeVal;
-    fd_set readSet;
-    char buf[UDP_MSGLEN];
+    char buf[UDP_MSGLEN], next[UDP_MSGLEN];
+    char action[UDP_MSGLEN];
+    int actionLen;
 
 
 #ifdef WIN32 
@@ -100,6 +146,7 @@ int main(int argc, char *argv[])
 //    parse_args(argc,argv,hostName,serverPort,id,maxEpisodes,maxSteps,noise,noiseAVG,noiseSTD,seed,trackName,stage);
 
     parse_args(argc,argv,hostName,serverPort,id,maxEpisodes,maxSteps,trackName,stage);
+    parse_client_options(argc,argv,options);
 
 //    if (seed>0)
 //    	srand(seed);
@@ -118,7 +165,10 @@ int main(int argc, char *argv[])
 
     cout << "HOST: "   << hostName    << endl;
 
-    cout << "PORT: " << serverPort  << endl;
+    if (options.lastPort > serverPort)
+        cout << "PORTS: " << serverPort << "-" << options.lastPort << endl;
+    else
+        cout << "PORT: " << serverPort  << endl;
 
     cout << "ID: "   << id     << endl;
 
@@ -140,6 +190,32 @@ int main(int argc, char *argv[])
 	else
 		cout << "STAGE: UNKNOWN" << endl;
 
+	if (options.lazyState)
+		cout << "LAZY: on" << endl;
+	if (options.binaryWire)
+		cout << "WIRE: binary (if the server accepts it)" << endl;
+	if (options.kernelTimestamps)
+		cout << "TIMESTAMPS: kernel" << endl;
+	if (options.watchFiles)
+		cout << "WATCH FILES: on" << endl;
+	if (options.budget > 0)
+		cout << "BUDGET: " << options.budget << " us" << endl;
+	cout << "IDENTIFICATION RETRY: " << options.retryFirst << "-" << options.retryMax << " us" << endl;
+	if (options.uring)
+		cout << "BACKEND: io_uring" << (options.sqpoll ? " with sqpoll" : "") << endl;
+	if (options.freshest)
+		cout << "FRESHEST SENSORS ONLY" << endl;
+	if (options.recordPath != NULL)
+		cout << "RECORD: " << options.recordPath << endl;
+	if (options.tracePath != NULL)
+		cout << "TRACE: " << options.tracePath << endl;
+	if (options.lowLatency.enabled)
+	{
+		cout << "LOWLATENCY: ";
+		options.lowLatency.print(cout);
+		cout << endl;
+	}
+
 	cout << "***********************************" << endl;
     // Create a socket (UDP on IPv4 protocol)
     socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
@@ -149,149 +225,244 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
+#ifdef __linux__
+    // kernel receive times, to measure how long the sensors wait in the socket
+    int enable = 1;
+    if (options.kernelTimestamps
+        && setsockopt(socketDescriptor, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0)
+    {
+        cerr << "kernel timestamps are not available\n";
+        options.kernelTimestamps = false;
+    }
+#else
+    options.kernelTimestamps = false;
+#endif
+
+    // before any driver (and its threads) exists, so they inherit it all
+    if (options.lowLatency.enabled)
+        options.lowLatency.apply(socketDescriptor, cerr);
+
     // Set some fields in the serverAddress structure.
     serverAddress.sin_family = hostInfo->h_addrtype;
     memcpy((char *) &serverAddress.sin_addr.s_addr,
            hostInfo->h_addr_list[0], hostInfo->h_length);
     serverAddress.sin_port = htons(serverPort);
 
+    // the io_uring backend is part of the multi-car client, even for one car
+    if (options.lastPort > serverPort || options.uring)
+    {
+#ifdef __linux__
+        int status = run_cars(socketDescriptor, serverAddress, serverPort,
+                              max(options.lastPort, serverPort), id, maxEpisodes, maxSteps,
+                              trackName, stage, options);
+        CLOSE(socketDescriptor);
+        return status;
+#else
+        cerr << "port ranges (multi-car client) are only supported on Linux\n";
+        CLOSE(socketDescriptor);
+        exit(1);
+#endif
+    }
+
     tDriver d;
     strcpy(d.trackName,trackName);
     d.stage = stage;
+    d.watchFiles = options.watchFiles;
+    WrapperBaseDriver *wrapper = dynamic_cast<WrapperBaseDriver *>(&d);
+    if (wrapper != NULL)
+        wrapper->lazyState = options.lazyState;
+
+    EventLoop loop;
+    if (!loop.isValid() || !loop.watch(socketDescriptor, 0) || !loop.addTimer(0)
+        || !loop.catchSignals())
+    {
+        cerr << "cannot set up the event loop\n";
+        CLOSE(socketDescriptor);
+        exit(1);
+    }
+
+    if (options.lowLatency.enabled)
+        loop.setSpin(options.lowLatency.spin);
 
-    bool shutdownClient=false;
-    unsigned long curEpisode=0;
-    do
+    CarSession session(d, id, maxEpisodes, maxSteps, options.binaryWire);
+    session.setBudget(options.budget);
+    if (options.recordPath != NULL && !session.record(options.recordPath))
+    {
+        cerr << "cannot create " << options.recordPath << endl;
+        CLOSE(socketDescriptor);
+        exit(1);
+    }
+    EventLoop::tevent events[3];
+    bool identify = true;
+    long retry = options.retryFirst;
+    long long lastHeard = 0;
+    while (session.getStatus() != CarSession::FINISHED)
     {
         /***********************************************************************************
         ************************* UDP client identification ********************************
         ***********************************************************************************/
-        do
+        if (identify && session.getStatus() == CarSession::IDENTIFYING)
         {
-        	// Initialize the angles of rangefinders
-        	float angles[19];
-        	d.init(angles);
-        	string initString = SimpleParser::stringify(string("init"),angles,19);
-            cout << "Sending id to server: " << id << endl;
-            initString.insert(0,id);
-            cout << "Sending init string to the server: " << initString << endl;
-            if (sendto(socketDescriptor, initString.c_str(), initString.length(), 0,
-                       (struct sockaddr *) &serverAddress,
-                       sizeof(serverAddress)) < 0)
+            actionLen = session.identification(action, UDP_MSGLEN);
+            if (actionLen < 0
+                || sendto(socketDescriptor, action, actionLen, 0,
+                          (struct sockaddr *) &serverAddress,
+                          sizeof(serverAddress)) < 0)
             {
                 cerr << "cannot send data ";
                 CLOSE(socketDescriptor);
                 exit(1);
             }
+            identify = false;
+            // wait until answer comes back, twice as long on every retry
+            loop.arm(0, retry);
+        }
 
-            // wait until answer comes back, for up to UDP_CLIENT_TIMEUOT micro sec
-            FD_ZERO(&readSet);
-            FD_SET(socketDescriptor, &readSet);
-            timeVal.tv_sec = 0;
-            timeVal.tv_usec = UDP_CLIENT_TIMEUOT;
-
-            if (select(socketDescriptor+1, &readSet, NULL, NULL, &timeVal))
-            {
-                // Read data sent by the solorace server
-                memset(buf, 0x0, UDP_MSGLEN);  // Zero out the buffer.
-                numRead = recv(socketDescriptor, buf, UDP_MSGLEN, 0);
-                if (numRead < 0)
-                {
-                    cerr << "didn't get response from server...";
-                }
-		else
-		{
-                	cout << "Received: " << buf << endl;
-
-                	if (strcmp(buf,"***identified***")==0)
-                    		break;
-            	}
-	      }
-
-        }  while(1);
-
-	unsigned long currentStep=0; 
+        int numEvents = loop.wait(events, 3);
+        long long woke = LatencyStats::now();
+        if (numEvents < 0)
+        {
+            cerr << "cannot wait for the server ";
+            CLOSE(socketDescriptor);
+            exit(1);
+        }
 
-        while(1)
+        for (int e = 0; e < numEvents && session.getStatus() != CarSession::FINISHED; e++)
         {
-            // wait until answer comes back, for up to UDP_CLIENT_TIMEUOT micro sec
-            FD_ZERO(&readSet);
-            FD_SET(socketDescriptor, &readSet);
-            timeVal.tv_sec = 0;
-            timeVal.tv_usec = UDP_CLIENT_TIMEUOT;
-
-            static int cont = 0;
-            if (select(socketDescriptor+1, &readSet, NULL, NULL, &timeVal))
+            if (events[e].kind == EventLoop::SIGNALED)
             {
-                // Read data sent by the solorace server
-                memset(buf, 0x0, UDP_MSGLEN);  // Zero out the buffer.
-                numRead = recv(socketDescriptor, buf, UDP_MSGLEN, 0);
-                if (numRead < 0)
+#ifdef SIGUSR1
+                if (events[e].id == SIGUSR1)
                 {
-                    cerr << "didn't get response from server?";
-                    CLOSE(socketDescriptor);
-                    exit(1);
+                    session.printStats(cout);
+                    if (options.tracePath != NULL)
+                        dump_trace(d, options.tracePath, 0);
+                    continue;
                 }
-
-#ifdef __UDP_CLIENT_VERBOSE__
-                cout << "Received: " << buf << endl;
 #endif
-
-                if (strcmp(buf,"***shutdown***")==0)
-                {
-                    d.onShutdown();
-                    shutdownClient = true;
-                    cout << "Client Shutdown" << endl;
-                    break;
-                }
-
-                if (strcmp(buf,"***restart***")==0)
+                cout << "Client Interrupted" << endl;
+                session.finish();
+            }
+            else if (events[e].kind == EventLoop::TIMEOUT)
+            {
+                if (session.getStatus() == CarSession::IDENTIFYING)
                 {
-                    d.onRestart();
-                    cout << "Client Restart" << endl;
-                    break;
+                    identify = true;
+                    retry = min(2*retry, options.retryMax);
                 }
-                /**************************************************
-                 * Compute The Action to send to the solorace sever
-                 **************************************************/
-
-		if ( (++currentStep) != maxSteps)
-		{
-                	string action = d.drive(string(buf));
-                	memset(buf, 0x0, UDP_MSGLEN);
-			sprintf(buf,"%s",action.c_str());
-		}
-		else
-	                sprintf (buf, "(meta 1)");
-
-                if (sendto(socketDescriptor, buf, strlen(buf)+1, 0,
-                           (struct sockaddr *) &serverAddress,
-                           sizeof(serverAddress)) < 0)
+                else
                 {
-                    cerr << "cannot send data ";
-                    CLOSE(socketDescriptor);
-                    exit(1);
+                    // the deadline is not moved on every message: it is
+                    // checked against the last one when it expires
+                    long long silent = now_us() - lastHeard;
+                    if (silent < UDP_CLIENT_TIMEUOT)
+                    {
+                        loop.arm(0, UDP_CLIENT_TIMEUOT - silent);
+                        continue;
+                    }
+                    session.timeout();
+                    loop.arm(0, UDP_CLIENT_TIMEUOT);
                 }
-#ifdef __UDP_CLIENT_VERBOSE__
-                else
-                    cout << "Sending " << buf << endl;
-#endif
             }
             else
             {
-                cont++;
-                cout << "** Server did not respond in " << cont << " second.\n";
-                if(cont == 10)
+                // Read everything sent by the solorace server
+                char *msg = buf, *spare = next;
+                bool empty = false;
+                while (!empty)
                 {
-                    shutdownClient = true;
-                    break;
+                    long long stamp, start = LatencyStats::now();
+                    numRead = recv_message(socketDescriptor, msg, options.kernelTimestamps, stamp);
+                    long long received = LatencyStats::now();
+                    if (numRead < 0)
+                        break;
+                    d.latency.record(LatencyStats::RECEIVE, received - start);
+#ifdef __linux__
+                    if (stamp > 0)
+                        d.latency.record(LatencyStats::QUEUE, realtime_ns() - stamp);
+#endif
+                    msg[numRead] = '\0';
+
+                    // freshest state wins: sensors with more messages queued
+                    // behind them are stale, so only the newest are driven on
+                    while (options.freshest && session.isSensors(msg))
+                    {
+                        start = LatencyStats::now();
+                        int numNext = recv_message(socketDescriptor, spare, options.kernelTimestamps, stamp);
+                        if (numNext < 0)
+                        {
+                            // the drain ends with this message
+                            empty = DRAINED();
+                            break;
+                        }
+                        received = LatencyStats::now();
+                        d.latency.record(LatencyStats::RECEIVE, received - start);
+#ifdef __linux__
+                        if (stamp > 0)
+                            d.latency.record(LatencyStats::QUEUE, realtime_ns() - stamp);
+#endif
+                        spare[numNext] = '\0';
+                        session.drop();
+                        swap(msg, spare);
+                        numRead = numNext;
+                    }
+                    CarSession::tstatus before = session.getStatus();
+
+                    actionLen = session.receive(msg, numRead, action, UDP_MSGLEN);
+                    if (actionLen > 0)
+                    {
+                        start = LatencyStats::now();
+                        if (sendto(socketDescriptor, action, actionLen, 0,
+                                   (struct sockaddr *) &serverAddress,
+                                   sizeof(serverAddress)) < 0)
+                        {
+                            cerr << "cannot send data ";
+                            CLOSE(socketDescriptor);
+                            exit(1);
+                        }
+                        long long sent = LatencyStats::now();
+                        d.latency.record(LatencyStats::SEND, sent - start);
+                        d.latency.record(LatencyStats::TICK, sent - received);
+                        d.latency.record(LatencyStats::WAKEUP, sent - woke);
+                        // the next message of the drain is read without sleeping
+                        woke = sent;
+                    }
+
+                    if (session.getStatus() == CarSession::DRIVING)
+                    {
+                        lastHeard = received / 1000;
+                        if (before == CarSession::IDENTIFYING)
+                        {
+                            loop.arm(0, UDP_CLIENT_TIMEUOT);
+                            retry = options.retryFirst;
+                        }
+                    }
+                    // a new episode (or an unexpected reply) is identified right away
+                    else if (session.getStatus() == CarSession::IDENTIFYING)
+                        identify = true;
+                    else
+                        break;
+                }
+                if (numRead < 0 && !DRAINED())
+                {
+                    if (session.getStatus() == CarSession::IDENTIFYING)
+                        cerr << "didn't get response from server...";
+                    else
+                    {
+                        cerr << "didn't get response from server?";
+                        CLOSE(socketDescriptor);
+                        exit(1);
+                    }
                 }
             }
         }
-    } while(shutdownClient==false && ( (++curEpisode) != maxEpisodes) );
+    }
+    session.finish();
+    if (options.lowLatency.enabled)
+        print_jitter(d.latency.get(LatencyStats::WAKEUP));
+    if (options.tracePath != NULL)
+        dump_trace(d, options.tracePath, 0);
 
-    if (shutdownClient==false)
-	d.onShutdown();
     CLOSE(socketDescriptor);
 #ifdef WIN32
     WSACleanup();
@@ -373,3 +544,579 @@ void parse_args(int argc, char *argv[], char *hostName, unsigned int &serverPort
     	}
     }
 }
+
+void parse_client_options(int argc, char *argv[], tClientOptions &options)
+{
+    // Set default values
+    options.lazyState = false;
+    options.binaryWire = false;
+    options.lastPort = 0;
+    options.kernelTimestamps = false;
+    options.budget = 0;
+    options.recordPath = NULL;
+    options.freshest = false;
+    options.uring = options.sqpoll = false;
+    options.retryFirst = UDP_CLIENT_RETRY;
+    options.retryMax = UDP_CLIENT_TIMEUOT;
+    options.watchFiles = false;
+    options.tracePath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "lazy:", 5) == 0)
+        {
+            int temp;
+            if (sscanf(argv[i],"lazy:%d",&temp) == 1)
+                options.lazyState = (temp != 0);
+        }
+        else if (strcmp(argv[i], "wire:binary") == 0)
+            options.binaryWire = true;
+        else if (strcmp(argv[i], "wire:text") == 0)
+            options.binaryWire = false;
+        else if (strncmp(argv[i], "fresh:", 6) == 0)
+        {
+            int temp;
+            if (sscanf(argv[i],"fresh:%d",&temp) == 1)
+                options.freshest = (temp != 0);
+        }
+        else if (strncmp(argv[i], "watch:", 6) == 0)
+        {
+            int temp;
+            if (sscanf(argv[i],"watch:%d",&temp) == 1)
+                options.watchFiles = (temp != 0);
+        }
+        else if (strncmp(argv[i], "timestamps:", 11) == 0)
+        {
+            int temp;
+            if (sscanf(argv[i],"timestamps:%d",&temp) == 1)
+                options.kernelTimestamps = (temp != 0);
+        }
+        else if (strncmp(argv[i], "lowlatency:", 11) == 0)
+        {
+            if (!options.lowLatency.parse(argv[i]+11))
+            {
+                cerr << "bad option " << argv[i] << ", expected lowlatency:<cpu>[,fifo[=priority]][,spin=<us>]\n";
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "backend:uring") == 0 || strcmp(argv[i], "backend:uring,sqpoll") == 0)
+        {
+            options.uring = true;
+            options.sqpoll = (strchr(argv[i], ',') != NULL);
+        }
+        else if (strcmp(argv[i], "backend:epoll") == 0)
+            options.uring = options.sqpoll = false;
+        else if (strncmp(argv[i], "retry:", 6) == 0)
+        {
+            long first, last;
+            int n = sscanf(argv[i],"retry:%ld-%ld",&first,&last);
+            if (n >= 1 && first > 0)
+                options.retryFirst = options.retryMax = first;
+            if (n == 2 && last > first)
+                options.retryMax = last;
+        }
+        else if (strncmp(argv[i], "budget:", 7) == 0)
+            sscanf(argv[i],"budget:%ld",&options.budget);
+        else if (strncmp(argv[i], "record:", 7) == 0 && argv[i][7] != '\0')
+            options.recordPath = argv[i]+7;
+        else if (strncmp(argv[i], "trace:", 6) == 0 && argv[i][6] != '\0')
+            options.tracePath = argv[i]+6;
+        else if (strncmp(argv[i], "port:", 5) == 0)
+        {
+            unsigned int first, last;
+            if (sscanf(argv[i],"port:%u-%u",&first,&last) == 2)
+                options.lastPort = last;
+        }
+        /* SCR and unknown args are handled by parse_args */
+    }
+}
+
+// Summary of the wakeup to send latencies, for the lowlatency settings
+void print_jitter(const LatencyHistogram &wakeups)
+{
+    cout << "WAKEUP TO SEND (us): p50 " << wakeups.percentile(0.5)/1e3
+         << ", p99 " << wakeups.percentile(0.99)/1e3
+         << ", p999 " << wakeups.percentile(0.999)/1e3
+         << ", max " << wakeups.max()/1e3 << " in " << wakeups.count() << " ticks" << endl;
+}
+
+// Writes the trace of a driver to path, or to path.<port> for the cars of
+// a multi-car client (port > 0)
+void dump_trace(BaseDriver &driver, const char *path, unsigned int port)
+{
+    string file = path;
+    if (port > 0)
+        file += "." + to_string(port);
+    if (driver.dumpTrace(file.c_str()))
+        cout << "TRACE written to " << file << endl;
+    else
+        cerr << "cannot write the trace to " << file << endl;
+}
+
+long long now_us()
+{
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reads one message of up to UDP_MSGLEN-1 bytes, with its kernel receive
+// time in stamp if stamped (0 if there is none)
+int recv_message(SOCKET socketDescriptor, char *buf, bool stamped, long long &stamp)
+{
+    stamp = 0;
+#ifdef __linux__
+    if (stamped)
+        return recv_stamped(socketDescriptor, buf, UDP_MSGLEN-1, stamp);
+#endif
+    return recv(socketDescriptor, buf, UDP_MSGLEN-1, 0);
+}
+
+#ifdef __linux__
+long long realtime_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+// Kernel receive time of a message read with SO_TIMESTAMPNS (in the
+// CLOCK_REALTIME ns of realtime_ns), or 0 if it has none.
+static long long kernel_stamp(struct msghdr *msg)
+{
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return ts.tv_sec*1000000000LL + ts.tv_nsec;
+        }
+    return 0;
+}
+
+// recv that also returns the kernel receive time in stamp
+int recv_stamped(SOCKET socketDescriptor, char *buf, size_t len, long long &stamp)
+{
+    char control[CMSG_SPACE(sizeof(struct timespec))];
+    struct iovec iov;
+    struct msghdr msg;
+    iov.iov_base = buf;
+    iov.iov_len = len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    int numRead = recvmsg(socketDescriptor, &msg, 0);
+    stamp = numRead >= 0 ? kernel_stamp(&msg) : 0;
+    return numRead;
+}
+
+// Datagrams of one direction for all the cars, moved with a single
+// recvmmsg/sendmmsg call.
+struct tBatch
+{
+    vector<char> data;
+    vector<struct mmsghdr> msgs;
+    vector<struct iovec> iovs;
+    vector<tSockAddrIn> addrs;
+    vector<char> control;       // kernel timestamps of received datagrams
+    vector<int> cars;           // car of each queued datagram
+    unsigned int count;
+
+    static const size_t CONTROL_LEN = CMSG_SPACE(sizeof(struct timespec));
+
+    tBatch(unsigned int size) : data(size*UDP_MSGLEN), msgs(size), iovs(size), addrs(size),
+                                control(size*CONTROL_LEN), cars(size), count(0)
+    {
+        for (unsigned int i = 0; i < size; i++)
+        {
+            iovs[i].iov_base = buffer(i);
+            iovs[i].iov_len = UDP_MSGLEN;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        }
+    }
+
+    char *buffer(unsigned int i) { return &data[i*UDP_MSGLEN]; }
+
+    // Queues the first len bytes of buffer(count) to addr, on behalf of car
+    // (-1 for identification).
+    void push(const tSockAddrIn &addr, int len, int car)
+    {
+        addrs[count] = addr;
+        iovs[count].iov_len = len;
+        msgs[count].msg_hdr.msg_namelen = sizeof(addr);
+        cars[count] = car;
+        count++;
+    }
+
+    // Makes every slot ready for recvmmsg (with room for a timestamp)
+    void reset(bool stamped)
+    {
+        for (unsigned int i = 0; i < msgs.size(); i++)
+        {
+            iovs[i].iov_len = UDP_MSGLEN-1;
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_control = stamped ? &control[i*CONTROL_LEN] : NULL;
+            msgs[i].msg_hdr.msg_controllen = stamped ? CONTROL_LEN : 0;
+        }
+    }
+};
+
+// Sends every datagram queued in out (through uring if it is not NULL),
+// returns false on a socket error.
+static bool flush(SOCKET socketDescriptor, tBatch &out, unsigned long &syscalls, UringSocket *uring)
+{
+    if (uring != NULL)
+    {
+        for (unsigned int i = 0; i < out.count; i++)
+            if (!uring->send(out.addrs[i], out.buffer(i), out.iovs[i].iov_len))
+                return false;
+        out.count = 0;
+        return uring->submit();
+    }
+    unsigned int sent = 0;
+    while (sent < out.count)
+    {
+        int n = sendmmsg(socketDescriptor, &out.msgs[sent], out.count - sent, 0);
+        syscalls++;
+        if (n < 0)
+            return false;
+        sent += n;
+    }
+    out.count = 0;
+    return true;
+}
+
+// Multi-car client: one driver and session per server port in
+// [firstPort,lastPort], all served by the same socket. The replies are
+// told apart by their source port, so each wakeup drains every pending
+// datagram with recvmmsg and answers them with one sendmmsg. Each car has
+// its own deadline in the event loop (the timer id is the car index). With
+// the io_uring backend the datagrams arrive in the buffers of a multishot
+// receive instead, and the answers leave through its submission ring.
+int run_cars(SOCKET socketDescriptor, const tSockAddrIn &serverAddress, unsigned int firstPort,
+             unsigned int lastPort, const char *id, unsigned int maxEpisodes, unsigned int maxSteps,
+             const char *trackName, BaseDriver::tstage stage, const tClientOptions &options)
+{
+    const unsigned int cars = lastPort - firstPort + 1;
+    vector<tDriver *> drivers(cars);
+    vector<CarSession *> sessions(cars);
+    vector<tSockAddrIn> addresses(cars, serverAddress);
+    vector<long long> lastHeard(cars, 0);
+    vector<bool> identify(cars, true);
+    vector<long> retry(cars, options.retryFirst);
+    vector<char> pending(cars*UDP_MSGLEN); // newest sensors of each car in a drain
+    vector<int> pendingLen(cars, -1);
+
+    UringSocket *uring = NULL;
+    if (options.uring)
+    {
+        uring = new UringSocket(socketDescriptor, 8*cars, UDP_MSGLEN-1,
+                                options.kernelTimestamps, options.sqpoll);
+        if (!uring->isValid())
+        {
+            cerr << "cannot set up io_uring (Linux 6.0 or later)\n";
+            delete uring;
+            return 1;
+        }
+    }
+
+    EventLoop loop;
+    bool failed = !loop.isValid() || !loop.catchSignals()
+                  || !loop.watch(uring != NULL ? uring->getFd() : socketDescriptor, 0);
+    for (unsigned int c = 0; c < cars && !failed; c++)
+        failed = !loop.addTimer(c);
+    if (failed)
+    {
+        cerr << "cannot set up the event loop\n";
+        delete uring;
+        return 1;
+    }
+    if (options.lowLatency.enabled)
+        loop.setSpin(options.lowLatency.spin);
+
+    for (unsigned int c = 0; c < cars; c++)
+    {
+        drivers[c] = new tDriver;
+        strcpy(drivers[c]->trackName,trackName);
+        drivers[c]->stage = stage;
+        drivers[c]->watchFiles = options.watchFiles;
+        WrapperBaseDriver *wrapper = dynamic_cast<WrapperBaseDriver *>(drivers[c]);
+        if (wrapper != NULL)
+            wrapper->lazyState = options.lazyState;
+        sessions[c] = new CarSession(*drivers[c], id, maxEpisodes, maxSteps, options.binaryWire);
+        sessions[c]->setBudget(options.budget);
+        addresses[c].sin_port = htons(firstPort + c);
+        if (options.recordPath != NULL)
+        {
+            // one log per car, named after its port
+            char path[1024];
+            snprintf(path, sizeof(path), "%s.%u", options.recordPath, firstPort + c);
+            if (!sessions[c]->record(path))
+            {
+                cerr << "cannot create " << path << endl;
+                return 1;
+            }
+        }
+    }
+
+    // a reap of the ring may bring every buffer, several per car
+    tBatch in(cars), out(uring != NULL ? uring->getBuffers() : cars);
+    vector<EventLoop::tevent> events(cars + 2);
+    unsigned long wakeups = 0, received = 0, syscalls = 0;
+    unsigned int finished = 0;
+    const long long start = now_us();
+
+    while (finished < cars && !failed)
+    {
+        // identify the cars waiting for the server (again every timeout)
+        for (unsigned int c = 0; c < cars && !failed; c++)
+        {
+            if (!identify[c] || sessions[c]->getStatus() != CarSession::IDENTIFYING)
+                continue;
+            int len = sessions[c]->identification(out.buffer(out.count), UDP_MSGLEN);
+            if (len < 0)
+                failed = true;
+            else
+            {
+                out.push(addresses[c], len, -1);
+                identify[c] = false;
+                loop.arm(c, retry[c]);
+            }
+        }
+        if (failed || !flush(socketDescriptor, out, syscalls, uring))
+        {
+            cerr << "cannot send data ";
+            failed = true;
+            break;
+        }
+
+        int numEvents = loop.wait(&events[0], events.size());
+        long long woke = LatencyStats::now();
+        syscalls++;
+        if (numEvents < 0)
+        {
+            cerr << "cannot wait for the server ";
+            failed = true;
+            break;
+        }
+
+        for (int e = 0; e < numEvents && finished < cars; e++)
+        {
+            if (events[e].kind == EventLoop::SIGNALED)
+            {
+                if (events[e].id == SIGUSR1)
+                {
+                    for (unsigned int c = 0; c < cars; c++)
+                    {
+                        cout << "CAR " << c << " (port " << firstPort + c << ")" << endl;
+                        sessions[c]->printStats(cout);
+                        if (options.tracePath != NULL)
+                            dump_trace(*drivers[c], options.tracePath, firstPort + c);
+                    }
+                    continue;
+                }
+                cout << "Client Interrupted" << endl;
+                finished = cars;
+            }
+            else if (events[e].kind == EventLoop::TIMEOUT)
+            {
+                unsigned int c = events[e].id;
+                CarSession &session = *sessions[c];
+                if (session.getStatus() == CarSession::IDENTIFYING)
+                {
+                    identify[c] = true;
+                    retry[c] = min(2*retry[c], options.retryMax);
+                }
+                else if (session.getStatus() == CarSession::DRIVING)
+                {
+                    long long silent = now_us() - lastHeard[c];
+                    if (silent < UDP_CLIENT_TIMEUOT)
+                        loop.arm(c, UDP_CLIENT_TIMEUOT - silent);
+                    else
+                    {
+                        session.timeout();
+                        if (session.getStatus() == CarSession::FINISHED)
+                            finished++;
+                        else
+                            loop.arm(c, UDP_CLIENT_TIMEUOT);
+                    }
+                }
+            }
+            else
+            {
+                // edge-triggered: read until the socket is empty, which
+                // recvmmsg signals by returning less than it was asked for
+                // (and the ring by having no new completions, which costs
+                // no system call to check)
+                wakeups++;
+                int numRead;
+                bool empty;
+                do
+                {
+                    long long start = LatencyStats::now();
+                    if (uring != NULL)
+                    {
+                        numRead = uring->reap() ? uring->received.size() : -1;
+                        empty = numRead == 0;
+                    }
+                    else
+                    {
+                        in.reset(options.kernelTimestamps);
+                        numRead = recvmmsg(socketDescriptor, &in.msgs[0], cars, MSG_DONTWAIT, NULL);
+                        syscalls++;
+                        // (errno is not kept: the drivers may change it)
+                        empty = numRead >= 0 ? numRead < (int) cars : DRAINED();
+                    }
+                    long long receivedAt = LatencyStats::now(), now = receivedAt / 1000;
+                    long long realtime = options.kernelTimestamps ? realtime_ns() : 0;
+                    if (numRead < 0 && !(options.freshest && empty))
+                        break;
+
+                    for (int i = 0; i < numRead; i++)
+                    {
+                        const tSockAddrIn &from = uring != NULL ? *uring->received[i].from : in.addrs[i];
+                        unsigned int c = ntohs(from.sin_port) - firstPort;
+                        if (c >= cars || from.sin_addr.s_addr != serverAddress.sin_addr.s_addr)
+                            continue;
+                        CarSession &session = *sessions[c];
+                        if (session.getStatus() == CarSession::FINISHED)
+                            continue;
+
+                        received++;
+                        BaseDriver &driver = *drivers[c];
+                        driver.latency.record(LatencyStats::RECEIVE, receivedAt - start);
+                        long long stamp;
+                        char *msg;
+                        unsigned int len;
+                        if (uring != NULL)
+                        {
+                            stamp = uring->received[i].stamp;
+                            msg = uring->received[i].data;
+                            len = uring->received[i].len;
+                        }
+                        else
+                        {
+                            stamp = options.kernelTimestamps ? kernel_stamp(&in.msgs[i].msg_hdr) : 0;
+                            msg = in.buffer(i);
+                            len = in.msgs[i].msg_len;
+                            msg[len] = '\0';
+                        }
+                        if (stamp > 0)
+                            driver.latency.record(LatencyStats::QUEUE, realtime - stamp);
+                        // freshest state wins: sensors wait for the end of the
+                        // drain, replaced by any newer ones
+                        if (options.freshest && pendingLen[c] >= 0)
+                        {
+                            session.drop();
+                            pendingLen[c] = -1;
+                        }
+                        if (options.freshest && session.isSensors(msg))
+                        {
+                            memcpy(&pending[c*UDP_MSGLEN], msg, len+1);
+                            pendingLen[c] = len;
+                            lastHeard[c] = now;
+                            continue;
+                        }
+                        CarSession::tstatus before = session.getStatus();
+
+                        int actionLen = session.receive(msg, len, out.buffer(out.count), UDP_MSGLEN);
+                        if (actionLen > 0)
+                            out.push(addresses[c], actionLen, c);
+
+                        if (session.getStatus() == CarSession::DRIVING)
+                        {
+                            lastHeard[c] = now;
+                            if (before == CarSession::IDENTIFYING)
+                            {
+                                loop.arm(c, UDP_CLIENT_TIMEUOT);
+                                retry[c] = options.retryFirst;
+                            }
+                        }
+                        // a new episode (or an unexpected reply) is identified right away
+                        else if (session.getStatus() == CarSession::IDENTIFYING)
+                            identify[c] = true;
+                        else
+                            finished++;
+                    }
+                    // the socket is empty, drive on the newest sensors
+                    if (options.freshest && empty)
+                        for (unsigned int c = 0; c < cars; c++)
+                        {
+                            if (pendingLen[c] < 0)
+                                continue;
+                            int actionLen = sessions[c]->receive(&pending[c*UDP_MSGLEN], pendingLen[c],
+                                                                 out.buffer(out.count), UDP_MSGLEN);
+                            if (actionLen > 0)
+                                out.push(addresses[c], actionLen, c);
+                            pendingLen[c] = -1;
+                        }
+                    if (uring != NULL)
+                        uring->release();
+                    // every answer of the batch leaves with the same sendmmsg
+                    unsigned int answers = out.count;
+                    start = LatencyStats::now();
+                    if (!flush(socketDescriptor, out, syscalls, uring))
+                    {
+                        cerr << "cannot send data ";
+                        failed = true;
+                    }
+                    long long sent = LatencyStats::now();
+                    for (unsigned int i = 0; i < answers; i++)
+                    {
+                        drivers[out.cars[i]]->latency.record(LatencyStats::SEND, sent - start);
+                        drivers[out.cars[i]]->latency.record(LatencyStats::TICK, sent - receivedAt);
+                        drivers[out.cars[i]]->latency.record(LatencyStats::WAKEUP, sent - woke);
+                    }
+                    // the next batch of the drain is read without sleeping
+                    woke = sent;
+                } while (!empty && !failed);
+                if (numRead < 0 && !empty)
+                {
+                    cerr << "didn't get response from server?";
+                    failed = true;
+                }
+            }
+        }
+    }
+
+    // per car and aggregate throughput
+    double seconds = (now_us() - start) / 1e6;
+    unsigned long steps = 0;
+    LatencyHistogram jitter;
+    cout << "***********************************" << endl;
+    for (unsigned int c = 0; c < cars; c++)
+    {
+        sessions[c]->finish();
+        jitter.add(drivers[c]->latency.get(LatencyStats::WAKEUP));
+        steps += sessions[c]->getSteps();
+        cout << "CAR " << c << " (port " << firstPort + c << "): " << sessions[c]->getSteps()
+             << " ticks, " << sessions[c]->getSteps() / seconds << " ticks/s" << endl;
+        if (options.tracePath != NULL)
+            dump_trace(*drivers[c], options.tracePath, firstPort + c);
+        delete sessions[c];
+        delete drivers[c];
+    }
+    cout << "ALL: " << steps << " ticks in " << seconds << " s, " << steps / seconds << " ticks/s" << endl;
+    if (uring != NULL)
+    {
+        syscalls += uring->getSyscalls();
+        if (uring->getSendErrors() > 0 || uring->getTruncated() > 0)
+            cout << "IO_URING: " << uring->getSendErrors() << " failed sends, "
+                 << uring->getTruncated() << " truncated messages" << endl;
+        delete uring;
+    }
+    if (wakeups > 0)
+        cout << "BATCHING: " << received << " messages in " << wakeups << " wakeups ("
+             << (double) received / wakeups << " per wakeup), " << syscalls << " syscalls ("
+             << (steps ? (double) syscalls / steps : 0) << " per tick)" << endl;
+    if (options.lowLatency.enabled)
+        print_jitter(jitter);
+    cout << "***********************************" << endl;
+    return failed ? 1 : 0;
+}
+#endif
@@ -0,0 +1,228 @@
+/***************************************************************************
+
+    file                 : bridge.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/* Translator between a client using the binary encoding (wire:binary) and a
+ * stock SCR server speaking the text protocol. The client connects to the
+ * bridge as if it were the server:
+ *
+ *     scr-bridge listen:3101 host:localhost port:3001
+ *     FSMDriver3 port:3101 wire:binary
+ *
+ * Clients that do not ask for the binary encoding are relayed unchanged, so
+ * the same bridge gives the text baseline for latency comparisons. */
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "CarControl.h"
+#include "CarState.h"
+
+#define UDP_MSGLEN 2048
+
+using namespace std;
+
+static volatile sig_atomic_t stopBridge = 0;
+
+static void
+onSignal(int)
+{
+    stopBridge = 1;
+}
+
+static long long
+nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+// Messages relayed in one direction and the time spent translating them
+struct Direction
+{
+    unsigned long messages;
+    unsigned long translated;
+    long long translateNs;
+
+    Direction() : messages(0), translated(0), translateNs(0) {}
+
+    void print(const char *name) const
+    {
+        cout << name << ": " << messages << " messages, " << translated << " translated";
+        if (translated)
+            cout << " (" << translateNs/translated << " ns each)";
+        cout << endl;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    char hostName[1000] = "localhost";
+    unsigned int serverPort = 3001, listenPort = 3101;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "host:", 5) == 0)
+            snprintf(hostName, sizeof(hostName), "%s", argv[i]+5);
+        else if (strncmp(argv[i], "port:", 5) == 0)
+            sscanf(argv[i], "port:%u", &serverPort);
+        else if (strncmp(argv[i], "listen:", 7) == 0)
+            sscanf(argv[i], "listen:%u", &listenPort);
+    }
+
+    struct hostent *hostInfo = gethostbyname(hostName);
+    if (hostInfo == NULL)
+    {
+        cerr << "Error: problem interpreting host: " << hostName << endl;
+        return 1;
+    }
+    struct sockaddr_in serverAddress;
+    memset(&serverAddress, 0, sizeof(serverAddress));
+    serverAddress.sin_family = hostInfo->h_addrtype;
+    memcpy(&serverAddress.sin_addr.s_addr, hostInfo->h_addr_list[0], hostInfo->h_length);
+    serverAddress.sin_port = htons(serverPort);
+
+    struct sockaddr_in listenAddress;
+    memset(&listenAddress, 0, sizeof(listenAddress));
+    listenAddress.sin_family = AF_INET;
+    listenAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    listenAddress.sin_port = htons(listenPort);
+
+    int clientSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    int serverSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (clientSocket < 0 || serverSocket < 0
+        || bind(clientSocket, (struct sockaddr *) &listenAddress, sizeof(listenAddress)) < 0)
+    {
+        cerr << "cannot create sockets on port " << listenPort << endl;
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    cout << "Bridging port " << listenPort << " to " << hostName << ":" << serverPort << endl;
+
+    struct sockaddr_in clientAddress;
+    socklen_t clientAddressLen = 0;
+    bool binaryRequested = false, binaryWire = false;
+    const size_t wireGroupLen = strlen(BinaryParser::WIRE_GROUP);
+    char buf[UDP_MSGLEN], out[UDP_MSGLEN];
+    Direction toServer, toClient;
+
+    struct pollfd fds[2];
+    fds[0].fd = clientSocket;
+    fds[0].events = POLLIN;
+    fds[1].fd = serverSocket;
+    fds[1].events = POLLIN;
+
+    while (!stopBridge)
+    {
+        if (poll(fds, 2, 1000) <= 0)
+            continue;
+
+        if (fds[0].revents & POLLIN)
+        {
+            struct sockaddr_in from;
+            socklen_t fromLen = sizeof(from);
+            int n = recvfrom(clientSocket, buf, UDP_MSGLEN-1, 0, (struct sockaddr *) &from, &fromLen);
+            if (n > 0)
+            {
+                buf[n] = '\0';
+                clientAddress = from;
+                clientAddressLen = fromLen;
+                const char *msg = buf;
+                int len = n;
+
+                if (BinaryParser::isBinary(buf, n, BinaryParser::BINARY_ACTION))
+                {
+                    long long start = nowNs();
+                    CarControl cc;
+                    int textLen;
+                    if (cc.fromBinary(buf, n) && (textLen = cc.toString(out, UDP_MSGLEN)) >= 0)
+                    {
+                        msg = out;
+                        len = textLen + 1;  // with its '\0', as the text client does
+                        toServer.translateNs += nowNs() - start;
+                        ++toServer.translated;
+                    }
+                }
+                else if (strstr(buf, "(init") != NULL)
+                {
+                    // an init string: take the wire group out for the stock server
+                    char *group = strstr(buf, BinaryParser::WIRE_GROUP);
+                    binaryRequested = (group != NULL);
+                    if (group != NULL)
+                    {
+                        memmove(group, group + wireGroupLen, strlen(group + wireGroupLen) + 1);
+                        len = strlen(buf);
+                    }
+                }
+                ++toServer.messages;
+                sendto(serverSocket, msg, len, 0, (struct sockaddr *) &serverAddress, sizeof(serverAddress));
+            }
+        }
+
+        if ((fds[1].revents & POLLIN) && clientAddressLen > 0)
+        {
+            int n = recv(serverSocket, buf, UDP_MSGLEN-1, 0);
+            if (n > 0)
+            {
+                buf[n] = '\0';
+                const char *msg = buf;
+                int len = n;
+
+                if (strcmp(buf, "***identified***") == 0)
+                {
+                    binaryWire = binaryRequested;
+                    if (binaryWire)
+                    {
+                        len = snprintf(out, UDP_MSGLEN, "%s%s", buf, BinaryParser::WIRE_GROUP);
+                        msg = out;
+                    }
+                }
+                else if (binaryWire && buf[0] != '*')
+                {
+                    long long start = nowNs();
+                    CarState cs(buf, n);
+                    int binaryLen = cs.toBinary(out, UDP_MSGLEN);
+                    if (binaryLen >= 0)
+                    {
+                        msg = out;
+                        len = binaryLen;
+                        toClient.translateNs += nowNs() - start;
+                        ++toClient.translated;
+                    }
+                }
+                ++toClient.messages;
+                sendto(clientSocket, msg, len, 0, (struct sockaddr *) &clientAddress, clientAddressLen);
+            }
+        }
+    }
+
+    toServer.print("client -> server");
+    toClient.print("server -> client");
+    close(clientSocket);
+    close(serverSocket);
+    return 0;
+}
@@ -0,0 +1,137 @@
+/***************************************************************************
+
+    file                 : fsmbench.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/* Times the transition and the state drive of the two FSM engines on the
+ * sensors of a session recorded by the client (record:<file>): FSMDriver3,
+ * whose transitions are a compiled TransitionTable and whose states are
+ * called through DrivingState pointers, and FSMDriver3S, whose states are
+ * in a StaticFSM and whose table (the same rules, see ThreeStateFSM.h)
+ * names them by position:
+ *
+ *     FSMDriver3 record:race.log
+ *     fsmbench log:race.log [repeat:<n>]
+ *
+ * Both drivers take every tick through their transition once (it keeps
+ * state, as the stuck tick count), and then the current state drives repeat
+ * times in a row; both are timed. The states and actions of the two must be
+ * the same (make replay DRIVER=FSMDriver3S checks the whole driver against
+ * the recording). */
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "LatencyStats.h"
+#include "SessionLog.h"
+#include "FSMDriver3.h"
+#include "FSMDriver3S.h"
+
+using namespace std;
+
+// Drives the sensors through d; returns the ns taken by the state drives,
+// adds those taken by the transitions to transitionNs, and keeps the state
+// and last action of each tick in actions
+static long long
+run(FSMDriver &d, const vector<CarState> &sensors, unsigned long repeat, vector<string> &actions,
+    long long &transitionNs)
+{
+    long long spent = 0;
+    for (size_t t = 0; t < sensors.size(); t++)
+    {
+        long long start = LatencyStats::now();
+        d.transition(sensors[t]);
+        transitionNs += LatencyStats::now() - start;
+        CarControl cc;
+        start = LatencyStats::now();
+        for (unsigned long i = 0; i < repeat; i++)
+            cc = d.stateDrive(sensors[t]);
+        spent += LatencyStats::now() - start;
+        actions.push_back(string(d.stateName()) + " " + cc.toString());
+    }
+    return spent;
+}
+
+// Sets up d as the client does for the recorded session
+static void
+prepare(FSMDriver &d, const SessionReader &log)
+{
+    float angles[19];
+    snprintf(d.trackName, sizeof(d.trackName), "%s", log.trackName.c_str());
+    d.stage = (BaseDriver::tstage) log.stage;
+    d.init(angles);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    unsigned long repeat = 16;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "log:", 4) == 0)
+            path = argv[i]+4;
+        else if (strncmp(argv[i], "repeat:", 7) == 0)
+            sscanf(argv[i], "repeat:%lu", &repeat);
+    }
+    if (path == NULL || repeat == 0)
+    {
+        cerr << "usage: " << argv[0] << " log:<file> [repeat:<n>]\n";
+        return 1;
+    }
+
+    SessionReader log;
+    if (!log.load(path))
+    {
+        cerr << "cannot read the session log " << path << endl;
+        return 1;
+    }
+
+    vector<CarState> sensors;
+    for (size_t r = 0; r < log.records.size(); r++)
+        if (log.records[r].type == SessionLog::SENSORS)
+            sensors.push_back(CarState(log.data(log.records[r]), log.records[r].len));
+    if (sensors.empty())
+    {
+        cerr << "no sensors in " << path << endl;
+        return 1;
+    }
+
+    vector<string> virtualActions, staticActions;
+    FSMDriver3 virtualDriver;
+    FSMDriver3S staticDriver;
+    prepare(virtualDriver, log);
+    prepare(staticDriver, log);
+    long long pointerNs = 0, indexNs = 0;
+    long long virtualNs = run(virtualDriver, sensors, repeat, virtualActions, pointerNs);
+    long long staticNs = run(staticDriver, sensors, repeat, staticActions, indexNs);
+
+    unsigned long diffs = 0;
+    for (size_t t = 0; t < sensors.size(); t++)
+        if (virtualActions[t] != staticActions[t] && diffs++ == 0)
+            cout << "tick " << t+1 << ": FSMDriver3 " << virtualActions[t]
+                 << "\n    FSMDriver3S " << staticActions[t] << endl;
+
+    double drives = (double) sensors.size() * repeat;
+    cout << sensors.size() << " ticks, " << repeat << " drives each, " << diffs << " differ" << endl;
+    cout << "FSMDriver3  (virtual states): " << virtualNs/drives << " ns per drive" << endl;
+    cout << "FSMDriver3S (static states):  " << staticNs/drives << " ns per drive, "
+         << (staticNs ? (double) virtualNs/staticNs : 0) << "x" << endl;
+    cout << "FSMDriver3  (table of state pointers): " << (double) pointerNs/sensors.size() << " ns per transition" << endl;
+    cout << "FSMDriver3S (table of state indices):  " << (double) indexNs/sensors.size() << " ns per transition, "
+         << (indexNs ? (double) pointerNs/indexNs : 0) << "x" << endl;
+
+    return diffs ? 2 : 0;
+}
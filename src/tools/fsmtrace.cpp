@@ -0,0 +1,196 @@
+/***************************************************************************
+
+    file                 : fsmtrace.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/* Decodes the trace a FSM driver dumps (see FSMTrace.h) with the client's
+ * trace:<file> option, on SIGUSR1 and at the end, or the replay tool's:
+ *
+ *     FSMDriver3 trace:car.trace
+ *     fsmtrace trace:car.trace [all:1] [chrome:<file.json>]
+ *
+ * It prints the state changes (every tick with all:1) and the ticks spent
+ * in each state. chrome:<file.json> exports the trace for a timeline
+ * viewer (chrome://tracing or Perfetto): one slice per stay in a state, an
+ * instant event per transition, and counters of the actuators and of the
+ * distance from the start. */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "FSMTrace.h"
+
+using namespace std;
+
+// The name of a state of the trace
+static string
+stateName(const vector<string> &states, unsigned char id)
+{
+    return id < states.size() ? states[id] : string("?");
+}
+
+// JSON string literal of s
+static string
+quote(const string &s)
+{
+    string q = "\"";
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        if (s[i] == '"' || s[i] == '\\')
+            q += '\\';
+        if ((unsigned char) s[i] >= 0x20)
+            q += s[i];
+    }
+    return q + "\"";
+}
+
+// What made a transition: the guards that held and the rule taken
+static string
+cause(const FSMTrace::trecord &r)
+{
+    if (r.rule == FSMTrace::NONE)
+        return "";
+    char text[64];
+    snprintf(text, sizeof(text), "rule %u, guards 0x%02x", r.rule, r.guards);
+    return text;
+}
+
+static void
+print(const vector<string> &states, const FSMTrace::trecord &r, long long first)
+{
+    cout << setw(8) << r.tick << setw(12) << fixed << setprecision(3) << (r.time - first)/1e6
+         << setw(10) << setprecision(1) << r.distFromStart << "  " << setw(12) << stateName(states, r.from);
+    cout << (r.from != r.to ? " -> " : "    ") << setw(12) << stateName(states, r.to)
+         << setprecision(3) << "  accel " << r.accel << " brake " << r.brake << " steer " << r.steer
+         << " clutch " << r.clutch << " gear " << r.gear;
+    string why = cause(r);
+    if (!why.empty())
+        cout << "  (" << why << ")";
+    cout << endl;
+}
+
+static bool
+exportChrome(const char *path, const vector<string> &states, const vector<FSMTrace::trecord> &records)
+{
+    ofstream out(path);
+    if (!out)
+        return false;
+    long long first = records.front().time;
+    out << fixed << setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"FSM driver\"}}";
+
+    // one slice per stay in a state, from its first tick to the next stay
+    size_t stay = 0;
+    for (size_t i = 1; i <= records.size(); i++)
+    {
+        if (i < records.size() && records[i].to == records[stay].to)
+            continue;
+        long long end = i < records.size() ? records[i].time : records[i-1].time;
+        out << ",\n{\"name\":" << quote(stateName(states, records[stay].to)) << ",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+            << ",\"ts\":" << (records[stay].time - first)/1e3 << ",\"dur\":" << (end - records[stay].time)/1e3
+            << ",\"args\":{\"first tick\":" << records[stay].tick << ",\"ticks\":" << i - stay << "}}";
+        stay = i;
+    }
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const FSMTrace::trecord &r = records[i];
+        double ts = (r.time - first)/1e3;
+        if (r.from != r.to)
+            out << ",\n{\"name\":" << quote(stateName(states, r.from) + " -> " + stateName(states, r.to))
+                << ",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":1,\"ts\":" << ts
+                << ",\"args\":{\"tick\":" << r.tick << ",\"distFromStart\":" << r.distFromStart
+                << ",\"cause\":" << quote(cause(r)) << "}}";
+        out << ",\n{\"name\":\"actuators\",\"ph\":\"C\",\"pid\":1,\"ts\":" << ts
+            << ",\"args\":{\"accel\":" << r.accel << ",\"brake\":" << r.brake << ",\"steer\":" << r.steer
+            << ",\"clutch\":" << r.clutch << "}}";
+        out << ",\n{\"name\":\"gear\",\"ph\":\"C\",\"pid\":1,\"ts\":" << ts << ",\"args\":{\"gear\":" << r.gear << "}}";
+        out << ",\n{\"name\":\"distFromStart\",\"ph\":\"C\",\"pid\":1,\"ts\":" << ts
+            << ",\"args\":{\"m\":" << r.distFromStart << "}}";
+    }
+    out << "\n]}\n";
+    return out.good();
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL, *chromePath = NULL;
+    bool all = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "trace:", 6) == 0)
+            path = argv[i]+6;
+        else if (strncmp(argv[i], "chrome:", 7) == 0 && argv[i][7] != '\0')
+            chromePath = argv[i]+7;
+        else if (strncmp(argv[i], "all:", 4) == 0)
+        {
+            int temp;
+            if (sscanf(argv[i], "all:%d", &temp) == 1)
+                all = (temp != 0);
+        }
+    }
+    if (path == NULL)
+    {
+        cerr << "usage: " << argv[0] << " trace:<file> [all:1] [chrome:<file.json>]\n";
+        return 1;
+    }
+
+    vector<string> states;
+    vector<FSMTrace::trecord> records;
+    if (!FSMTrace::load(path, states, records))
+    {
+        cerr << "cannot read the trace " << path << endl;
+        return 1;
+    }
+    if (records.empty())
+    {
+        cout << "no ticks in " << path << endl;
+        return 0;
+    }
+
+    long long first = records.front().time;
+    vector<unsigned long> ticks(states.size() + 1);
+    unsigned long changes = 0;
+    cout << "    tick     time ms      dist  state" << endl;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const FSMTrace::trecord &r = records[i];
+        ticks[r.to < states.size() ? r.to : states.size()]++;
+        if (r.from != r.to)
+            changes++;
+        if (all || r.from != r.to || i == 0 || i+1 == records.size())
+            print(states, r, first);
+    }
+
+    cout << records.size() << " ticks (" << records.front().tick << " to " << records.back().tick << "), "
+         << changes << " state changes" << endl;
+    for (size_t s = 0; s < ticks.size(); s++)
+        if (ticks[s])
+            cout << "    " << (s < states.size() ? states[s] : string("?")) << ": " << ticks[s] << " ticks" << endl;
+
+    if (chromePath != NULL)
+    {
+        if (!exportChrome(chromePath, states, records))
+        {
+            cerr << "cannot write " << chromePath << endl;
+            return 1;
+        }
+        cout << "Chrome trace written to " << chromePath << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,379 @@
+/***************************************************************************
+
+    file                 : landmarkbench.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/* Times the landmarks of the online learning (see Landmarks.h) and their
+ * speed caps (see SpeedGrid.h) with n landmarks spread over a lap:
+ *
+ *     landmarkbench [n:<count>] [lap:<m>] [seed:<n>] [file:<path>]
+ *
+ * It adds the n landmarks one at a time, then finds the one ahead of n
+ * random places, checking a sample of them against a scan of all the
+ * landmarks. It does the same with the speed caps, checked against the
+ * lowest speed of the landmarks in the bins ahead, and checks that they
+ * wrap to the start of the lap only once the car crosses the line. For
+ * comparison it times adding landmarks as the drivers did before, a
+ * push_back and a sort of the whole vector, at the size of n (that is
+ * O(n log n) per landmark, so only a few are timed).
+ *
+ * The compaction (see Landmarks::compact) is run as in a session: n
+ * landmarks from excursions at a few corners, each tick adding one and
+ * doing a few steps, timing the slowest tick. The landmarks kept must cap
+ * every landmark added, a pass made one step per call must end and keep
+ * as many, and a limit on the landmarks must hold.
+ *
+ * Then it writes the landmarks to a knowledge file (see KnowledgeFile.h,
+ * /tmp/landmarkbench.bin by default) and times loading it, against reading
+ * a bare array of the same landmarks with ifstream as the drivers did. The
+ * file read must hold the landmarks written, and a file with a corrupted
+ * landmark must be refused, as must a bare array cut short or holding a
+ * negative or NaN value. Writers of the same file at once must all
+ * succeed and leave it whole. */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "LatencyStats.h"
+#include "KnowledgeFile.h"
+#include "Landmarks.h"
+#include "SpeedGrid.h"
+
+using namespace std;
+
+// The landmark ahead of distFromStart, by scanning them all
+static const Knowledge *
+scanAhead(const vector<Knowledge> &all, float distFromStart)
+{
+    const Knowledge *next = NULL, *first = NULL;
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        if (first == NULL || all[i].landmark < first->landmark)
+            first = &all[i];
+        if (all[i].landmark >= distFromStart && (next == NULL || all[i].landmark < next->landmark))
+            next = &all[i];
+    }
+    return next ? next : first;
+}
+
+// The cap of the bins ahead of distFromStart, by scanning all the landmarks
+static float
+scanCap(const vector<Knowledge> &all, float distFromStart, float binLength, unsigned int window,
+        unsigned int bins)
+{
+    unsigned int first = (unsigned int) (distFromStart / binLength);
+    float cap = INFINITY;
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        unsigned int b = (unsigned int) (all[i].landmark / binLength);
+        if ((b + bins - first) % bins < window)
+            cap = min(cap, all[i].targetSpeed);
+    }
+    return cap;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long n = 1000000, seed = 1;
+    float lap = 5000;
+    string path = "/tmp/landmarkbench.bin";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "n:", 2) == 0)
+            sscanf(argv[i], "n:%lu", &n);
+        else if (strncmp(argv[i], "lap:", 4) == 0)
+            sscanf(argv[i], "lap:%f", &lap);
+        else if (strncmp(argv[i], "seed:", 5) == 0)
+            sscanf(argv[i], "seed:%lu", &seed);
+        else if (strncmp(argv[i], "file:", 5) == 0)
+            path = argv[i] + 5;
+    }
+    if (n == 0 || lap <= 0)
+    {
+        cerr << "usage: " << argv[0] << " [n:<count>] [lap:<m>] [seed:<n>] [file:<path>]\n";
+        return 1;
+    }
+
+    srand(seed);
+    vector<Knowledge> all(n);
+    vector<float> places(n);
+    for (unsigned long i = 0; i < n; i++)
+    {
+        all[i] = Knowledge(50 + rand() % 250, lap * rand() / ((float) RAND_MAX + 1));
+        places[i] = lap * rand() / ((float) RAND_MAX + 1);
+    }
+
+    // the landmarks far apart, not merged, as many as there are
+    Landmarks landmarks;
+    landmarks.setCompaction(0, n);
+    long long start = LatencyStats::now();
+    for (unsigned long i = 0; i < n; i++)
+        landmarks.insert(all[i]);
+    long long inserted = LatencyStats::now() - start;
+
+    float speeds = 0;
+    start = LatencyStats::now();
+    for (unsigned long i = 0; i < n; i++)
+        speeds += landmarks.ahead(places[i])->targetSpeed;
+    long long found = LatencyStats::now() - start;
+
+    // the landmark found must be at the same distance as the nearest one
+    unsigned long checked = min(n, 1000UL), wrong = 0;
+    for (unsigned long i = 0; i < checked; i++)
+        if (landmarks.ahead(places[i])->landmark != scanAhead(all, places[i])->landmark)
+            wrong++;
+
+    // a lap driven, from the line back to it
+    SpeedGrid grid;
+    grid.reach(lap);
+    grid.reach(0);
+    start = LatencyStats::now();
+    for (unsigned long i = 0; i < n; i++)
+        grid.add(all[i]);
+    long long capped = LatencyStats::now() - start;
+
+    float caps = 0;
+    start = LatencyStats::now();
+    for (unsigned long i = 0; i < n; i++)
+        caps += grid.cap(places[i]);
+    long long read = LatencyStats::now() - start;
+
+    unsigned long capsWrong = 0;
+    unsigned int bins = (unsigned int) (grid.getLength() / grid.getBinLength());
+    unsigned int window = (unsigned int) ceilf(100 / grid.getBinLength());
+    for (unsigned long i = 0; i < checked; i++)
+        if (grid.cap(places[i]) != scanCap(all, places[i], grid.getBinLength(), window, bins))
+            capsWrong++;
+
+    // before the lap is known, the bins past a landmark are not capped by it
+    // as if the lap ended at the farthest bin reached; once the car crosses
+    // the line, the last bins are. Garbage distances leave the grid alone.
+    SpeedGrid first;
+    for (float d = 0; d <= 50; d += 1)
+        first.reach(d);
+    first.add(Knowledge(90, 50));
+    bool unwrapped = first.cap(0) == 90;
+    for (float d = 50; d <= 2000; d += 1)
+        first.reach(d);
+    for (float d = 250; d <= 2000; d += 250)
+        unwrapped = unwrapped && first.cap(d) == INFINITY;
+    first.reach(1e12f);
+    first.reach(NAN);
+    first.reach(-INFINITY);
+    unwrapped = unwrapped && !first.isLap() && first.getLength() == 2010;
+    first.reach(0.5f);
+    bool wrapped = first.isLap() && first.cap(2000) == 90 && first.cap(1900) == INFINITY;
+
+    // push_back and sort, with n-1 landmarks already there
+    unsigned long sorts = min(n, 20UL);
+    vector<Knowledge> sorted(all.begin(), all.end() - sorts);
+    sort(sorted.begin(), sorted.end(), Knowledge::aux_sort);
+    start = LatencyStats::now();
+    for (unsigned long i = n - sorts; i < n; i++)
+    {
+        sorted.push_back(all[i]);
+        sort(sorted.begin(), sorted.end(), Knowledge::aux_sort);
+    }
+    long long resorted = LatencyStats::now() - start;
+
+    // the knowledge file, written and loaded as by the drivers
+    vector<Knowledge> ordered;
+    landmarks.forEachCompacted([&ordered](const Knowledge &k) { ordered.push_back(k); });
+    start = LatencyStats::now();
+    bool written = KnowledgeFile::write(path.c_str(), landmarks);
+    long long wrote = LatencyStats::now() - start;
+
+    KnowledgeFile file;
+    Landmarks loaded;
+    loaded.setCompaction(0, 2*n);
+    start = LatencyStats::now();
+    bool opened = file.open(path.c_str());
+    loaded.assign(file.data(), file.size());
+    long long mapped = LatencyStats::now() - start;
+    vector<Knowledge> back;
+    loaded.copy(back);
+    bool same = written && opened && back.size() == ordered.size();
+    for (size_t i = 0; same && i < back.size(); i++)
+        same = back[i].landmark == ordered[i].landmark && back[i].targetSpeed == ordered[i].targetSpeed;
+    file.close();
+
+    // as the drivers did: a bare array, read with ifstream
+    string legacy = path + ".legacy";
+    ofstream out(legacy.c_str(), ios::binary | ios::out);
+    out.write(reinterpret_cast<const char *>(ordered.data()), ordered.size()*sizeof(Knowledge));
+    out.close();
+    start = LatencyStats::now();
+    ifstream in(legacy.c_str(), ios::in | ios::binary);
+    in.seekg(0, ios::end);
+    size_t count = in.tellg() / sizeof(Knowledge);
+    in.seekg(0, ifstream::beg);
+    vector<Knowledge> learnt(count);
+    in.read(reinterpret_cast<char *>(learnt.data()), count*sizeof(Knowledge));
+    in.close();
+    Landmarks streamed;
+    streamed.assign(learnt.data(), learnt.size());
+    long long legacyRead = LatencyStats::now() - start;
+    // that file is still read
+    same = same && file.open(legacy.c_str()) && file.size() == ordered.size();
+    file.close();
+    remove(legacy.c_str());
+
+    // a landmark changed on disk fails the checksum
+    bool refused = false;
+    FILE *f = fopen(path.c_str(), "r+b");
+    if (f != NULL)
+    {
+        fseek(f, KnowledgeFile::HEADER_LEN + (n / 2) * KnowledgeFile::RECORD_LEN, SEEK_SET);
+        int c = fgetc(f);
+        fseek(f, -1, SEEK_CUR);
+        fputc(c ^ 1, f);
+        fclose(f);
+        refused = !file.open(path.c_str()) && file.size() == 0;
+    }
+    remove(path.c_str());
+
+    // a bare array is not taken for one of the first drivers if it is cut
+    // short or holds a value they could not have written
+    float damaged[3][2] = {{ordered[0].targetSpeed, -1}, {NAN, ordered[0].landmark}, {0, 0}};
+    size_t lengths[3] = {sizeof(Knowledge), sizeof(Knowledge), sizeof(Knowledge) - 1};
+    for (int i = 0; i < 3; i++)
+    {
+        ofstream bad(legacy.c_str(), ios::binary | ios::out);
+        bad.write(reinterpret_cast<const char *>(damaged[i]), lengths[i]);
+        bad.close();
+        refused = refused && !file.open(legacy.c_str()) && file.size() == 0;
+    }
+    remove(legacy.c_str());
+
+    // writers at once, as the replayed drivers of a session: each has a
+    // temporary file of its own, so all succeed and the file is whole
+    vector<thread> writers;
+    vector<char> wroteAll(8);
+    for (size_t i = 0; i < wroteAll.size(); i++)
+        writers.push_back(thread([&, i]() { wroteAll[i] = KnowledgeFile::write(path.c_str(), landmarks); }));
+    for (size_t i = 0; i < writers.size(); i++)
+        writers[i].join();
+    bool concurrent = find(wroteAll.begin(), wroteAll.end(), 0) == wroteAll.end()
+                      && file.open(path.c_str()) && file.size() == ordered.size();
+    file.close();
+    remove(path.c_str());
+
+    // compaction during a session: excursions of 30 ticks, 0.5 m apart, at
+    // 50 corners, a landmark and a few steps of the compaction per tick
+    vector<float> corners(50);
+    for (size_t i = 0; i < corners.size(); i++)
+        corners[i] = (lap - 20) * rand() / ((float) RAND_MAX + 1);
+    vector<Knowledge> session(n);
+    for (unsigned long i = 0; i < n; i++)
+    {
+        if (i % 30 == 0)
+            session[i].landmark = corners[rand() % corners.size()] + rand() % 5;
+        else
+            session[i].landmark = session[i-1].landmark + 0.5f;
+        session[i].targetSpeed = 80 + rand() % 100;
+    }
+    Landmarks compacted;
+    vector<long long> ticks(n);
+    start = LatencyStats::now();
+    for (unsigned long i = 0; i < n; i++)
+    {
+        long long tick = LatencyStats::now();
+        compacted.insert(session[i]);
+        compacted.compact(8);
+        ticks[i] = LatencyStats::now() - tick;
+    }
+    long long compacting = LatencyStats::now() - start;
+    sort(ticks.begin(), ticks.end());
+    unsigned long finishing = 0;
+    while (compacted.compact(8))
+        finishing++;
+    vector<Knowledge> kept;
+    compacted.copy(kept);
+
+    // each landmark must still be capped: one kept at most the radius
+    // before it, as slow
+    unsigned long uncapped = 0;
+    for (unsigned long i = 0; i < checked; i++)
+    {
+        const Knowledge &k = session[rand() % n];
+        vector<Knowledge>::iterator c = lower_bound(kept.begin(), kept.end(), Knowledge(0, k.landmark - Landmarks::RADIUS),
+                                                    Knowledge::aux_sort);
+        while (c != kept.end() && c->landmark <= k.landmark && c->targetSpeed > k.targetSpeed)
+            ++c;
+        if (c == kept.end() || c->landmark > k.landmark)
+            uncapped++;
+    }
+
+    // a whole pass at once, for comparison: merging the landmarks of the tree
+    unsigned long merged = 0;
+    start = LatencyStats::now();
+    landmarks.forEachCompacted([&merged](const Knowledge &) { merged++; });
+    long long whole = LatencyStats::now() - start;
+
+    // one step per call still gets through a pass, and keeps what many
+    // steps at once keep
+    unsigned long few = min(n, 10000UL), single = 0;
+    Landmarks stepped, atOnce;
+    for (unsigned long i = 0; i < few; i++)
+    {
+        stepped.insert(session[i]);
+        atOnce.insert(session[i]);
+    }
+    while (single <= 4*few && stepped.compact(1))
+        single++;
+    while (atOnce.compact(few))
+        ;
+    bool oneStep = single <= 4*few && stepped.size() == atOnce.size();
+
+    // the hard limit: landmarks far apart, 1000 at most
+    Landmarks bounded;
+    bounded.setCompaction(Landmarks::RADIUS, 1000);
+    for (unsigned long i = 0; i < n; i++)
+        bounded.insert(all[i]);
+    bool capped_count = bounded.size() <= 1000;
+
+    cout << n << " landmarks on a " << lap << " m lap (checksums " << speeds << ", " << caps << ")" << endl;
+    cout << "Landmarks insert:        " << (double) inserted/n << " ns per landmark" << endl;
+    cout << "Landmarks ahead:         " << (double) found/n << " ns per lookup, "
+         << wrong << " of " << checked << " differ from a scan" << endl;
+    cout << "SpeedGrid add:           " << (double) capped/n << " ns per landmark" << endl;
+    cout << "SpeedGrid cap:           " << (double) read/n << " ns per lookup, "
+         << capsWrong << " of " << checked << " differ from a scan" << endl;
+    cout << "SpeedGrid first lap:     " << (unwrapped ? "not wrapped" : "wrapped") << " before the line, "
+         << (wrapped ? "wrapped" : "not wrapped") << " after it" << endl;
+    cout << "push_back and sort:      " << (double) resorted/sorts << " ns per landmark (at "
+         << n << ", " << sorts << " timed)" << endl;
+    cout << "KnowledgeFile write:     " << wrote/1000 << " us" << endl;
+    cout << "KnowledgeFile open:      " << mapped/1000 << " us, "
+         << (same ? "same landmarks" : "landmarks differ") << ", corrupted file "
+         << (refused ? "refused" : "accepted") << ", " << wroteAll.size() << " writers at once "
+         << (concurrent ? "succeed" : "fail") << endl;
+    cout << "ifstream read:           " << legacyRead/1000 << " us" << endl;
+
+    cout << "Compaction:              " << (double) compacting/n << " ns per tick, slowest "
+         << ticks[n - 1] << " ns (99.99%: " << ticks[n - 1 - n / 10000] << " ns), " << kept.size() << " of " << n << " landmarks kept ("
+         << finishing << " more calls), " << uncapped << " of " << checked << " left uncapped" << endl;
+    cout << "Compaction at once:      " << whole/1000 << " us for " << landmarks.size() << " landmarks ("
+         << merged << " merged)" << endl;
+    cout << "Compaction step by step: " << single << " calls of compact(1) for " << few << " landmarks, "
+         << stepped.size() << " kept (" << atOnce.size() << " at once)" << endl;
+    cout << "Limit of 1000:           " << bounded.size() << " landmarks" << endl;
+
+    return uncapped || !oneStep || !capped_count || wrong || capsWrong || !unwrapped || !wrapped || !same || !refused || !concurrent ? 2 : 0;
+}
@@ -0,0 +1,316 @@
+/***************************************************************************
+
+    file                 : replay.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/* Offline replay of a session recorded by the client (record:<file>): the
+ * recorded sensors are fed to the driver the tool is built with (make
+ * replay DRIVER=...), with no sockets and as fast as one core allows, and
+ * the actions it computes are compared with the recorded ones:
+ *
+ *     FSMDriver3 record:race.log
+ *     FSMDriver3-replay log:race.log [repeat:<n>] [threads:<n>] [lazy:1] [diffs:<n>] [trace:<file>]
+ *
+ * Each of the repeat passes uses a new driver. The drivers do not save
+ * files (BaseDriver::saveFiles), and a pass that writes any file in the
+ * working directory or the track's (other than the trace) fails, so no
+ * pass depends on another. A driver that keeps state between runs (static
+ * variables) or that was sent its fallback under a budget will not match
+ * the recording exactly.
+ *
+ * With threads:<n> each pass runs n drivers at once, one per thread, each
+ * compared with the recording: a stress test for drivers that share state
+ * between instances, which multi-car hosting cannot afford.
+ *
+ * trace:<file> dumps the trace of the last driver (see FSMTrace.h), to be
+ * decoded with bin/fsmtrace. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "LatencyStats.h"
+#include "SessionLog.h"
+#include "WrapperBaseDriver.h"
+#include __DRIVER_INCLUDE__
+
+#define UDP_MSGLEN 1000
+
+using namespace std;
+
+class __DRIVER_CLASS__;
+typedef __DRIVER_CLASS__ tDriver;
+
+// Prints an action, or its length if it is in the binary encoding
+static void
+printAction(const char *action, size_t len)
+{
+    if (memchr(action, '\0', len) != NULL || (len > 0 && action[0] != '('))
+        cout << "<" << len << " binary bytes>";
+    else
+        cout.write(action, len);
+}
+
+// Outcome of feeding the log through one driver
+typedef struct
+{
+    unsigned long driven, diffs;
+    long long elapsed;
+} tpass;
+
+// The files of some directories, by path, with their size and modification
+// time
+typedef map<string, pair<long long, long long> > tfiles;
+
+static void
+listFiles(const vector<string> &dirs, tfiles &files)
+{
+    files.clear();
+    for (size_t i = 0; i < dirs.size(); i++)
+    {
+        DIR *dir = opendir(dirs[i].c_str());
+        if (dir == NULL)
+            continue;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL)
+        {
+            string path = dirs[i] == "." ? entry->d_name : dirs[i] + "/" + entry->d_name;
+            struct stat st;
+            if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+                files[path] = make_pair((long long) st.st_size,
+                                        st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec);
+        }
+        closedir(dir);
+    }
+}
+
+// Whether two paths name the same file
+static bool
+sameFile(const char *a, const char *b)
+{
+    struct stat sa, sb;
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+// Serializes the reports of the drivers running at once
+static mutex printLock;
+
+// Feeds the log through a new driver, printing its first maxDiffs actions
+// that differ from the recorded ones, and its latencies if printLatency
+// (and dumping its trace to tracePath then, if not NULL)
+static void
+replay(const SessionReader &log, bool lazyState, unsigned long maxDiffs, bool printLatency,
+       const char *tracePath, tpass *result)
+{
+    vector<char> sensors;
+    char action[UDP_MSGLEN];
+    float angles[19];
+
+    tDriver *d = new tDriver;
+    snprintf(d->trackName, sizeof(d->trackName), "%s", log.trackName.c_str());
+    d->stage = (BaseDriver::tstage) log.stage;
+    d->saveFiles = false;
+    WrapperBaseDriver *wrapper = dynamic_cast<WrapperBaseDriver *>(d);
+    if (wrapper != NULL)
+        wrapper->lazyState = lazyState;
+    d->init(angles);
+
+    unsigned long driven = 0, diffs = 0;
+    long long started = LatencyStats::now();
+    for (size_t r = 0; r < log.records.size(); r++)
+    {
+        const SessionReader::trecord &record = log.records[r];
+        if (record.type == SessionLog::RESTART)
+        {
+            // the driver is initialized once, as in the client
+            d->onRestart();
+            continue;
+        }
+        if (record.type == SessionLog::SHUTDOWN)
+        {
+            d->onShutdown();
+            continue;
+        }
+        if (record.type != SessionLog::SENSORS)
+            continue;
+
+        // the driver expects the message '\0' terminated, as received
+        sensors.assign(log.data(record), log.data(record) + record.len);
+        sensors.push_back('\0');
+
+        long long tick = LatencyStats::now();
+        int len = d->drive(&sensors[0], record.len, action, sizeof(action));
+        d->latency.record(LatencyStats::TICK, LatencyStats::now() - tick);
+        driven++;
+
+        if (r+1 >= log.records.size() || log.records[r+1].type != SessionLog::ACTION)
+            continue;
+        const SessionReader::trecord &expected = log.records[r+1];
+        if (len >= 0 && (size_t) len == expected.len
+            && memcmp(action, log.data(expected), len) == 0)
+            continue;
+        if (diffs++ < maxDiffs)
+        {
+            lock_guard<mutex> guard(printLock);
+            cout << "tick " << driven << ": recorded ";
+            printAction(log.data(expected), expected.len);
+            cout << "\n    replayed ";
+            if (len < 0)
+                cout << "<no action>";
+            else
+                printAction(action, len);
+            cout << endl;
+        }
+    }
+    result->elapsed = LatencyStats::now() - started;
+    result->driven = driven;
+    result->diffs = diffs;
+
+    if (printLatency)
+    {
+        lock_guard<mutex> guard(printLock);
+        d->latency.print(cout);
+        if (tracePath != NULL && !d->dumpTrace(tracePath))
+            cerr << "cannot write the trace to " << tracePath << endl;
+    }
+    delete d;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL, *tracePath = NULL;
+    unsigned long repeat = 1, threads = 1, maxDiffs = 5;
+    bool lazyState = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "log:", 4) == 0)
+            path = argv[i]+4;
+        else if (strncmp(argv[i], "repeat:", 7) == 0)
+            sscanf(argv[i], "repeat:%lu", &repeat);
+        else if (strncmp(argv[i], "threads:", 8) == 0)
+            sscanf(argv[i], "threads:%lu", &threads);
+        else if (strncmp(argv[i], "trace:", 6) == 0 && argv[i][6] != '\0')
+            tracePath = argv[i]+6;
+        else if (strncmp(argv[i], "diffs:", 6) == 0)
+            sscanf(argv[i], "diffs:%lu", &maxDiffs);
+        else if (strncmp(argv[i], "lazy:", 5) == 0)
+        {
+            int temp;
+            if (sscanf(argv[i], "lazy:%d", &temp) == 1)
+                lazyState = (temp != 0);
+        }
+    }
+    if (path == NULL || threads == 0)
+    {
+        cerr << "usage: " << argv[0] << " log:<file> [repeat:<n>] [threads:<n>] [lazy:1] [diffs:<n>] [trace:<file>]\n";
+        return 1;
+    }
+
+    SessionReader log;
+    if (!log.load(path))
+    {
+        cerr << "cannot read the session log " << path << endl;
+        return 1;
+    }
+
+    // The recorded timing: how long the client took from receiving the
+    // sensors to having the action
+    unsigned long ticks = 0;
+    LatencyHistogram recorded;
+    for (size_t r = 0; r < log.records.size(); r++)
+        if (log.records[r].type == SessionLog::SENSORS)
+        {
+            ticks++;
+            if (r+1 < log.records.size() && log.records[r+1].type == SessionLog::ACTION)
+                recorded.record(log.records[r+1].time - log.records[r].time);
+        }
+    long long span = log.records.empty() ? 0 : log.records.back().time - log.records.front().time;
+
+    cout << "Session of " << log.id << " on " << log.trackName << " (stage " << log.stage << "): "
+         << ticks << " ticks in " << span/1e9 << " s" << endl;
+    cout << "Recorded drive: mean " << recorded.mean()/1e3 << " us, p99 "
+         << recorded.percentile(0.99)/1e3 << " us, max " << recorded.max()/1e3 << " us" << endl;
+
+    // The files the drivers read: in the working directory, and by the
+    // track name
+    vector<string> dirs(1, ".");
+    string::size_type slash = log.trackName.rfind('/');
+    if (slash != string::npos)
+        dirs.push_back(slash == 0 ? "/" : log.trackName.substr(0, slash));
+    tfiles before, after;
+
+    bool identical = true;
+    vector<tpass> results(threads);
+
+    for (unsigned long pass = 0; pass < repeat; pass++)
+    {
+        bool last = (pass+1 == repeat);
+        listFiles(dirs, before);
+        long long started = LatencyStats::now();
+        if (threads == 1)
+            replay(log, lazyState, maxDiffs, last, tracePath, &results[0]);
+        else
+        {
+            vector<thread> workers;
+            for (unsigned long t = 0; t < threads; t++)
+                workers.push_back(thread(replay, std::cref(log), lazyState, maxDiffs,
+                                         last && t == 0, tracePath, &results[t]));
+            for (unsigned long t = 0; t < threads; t++)
+                workers[t].join();
+        }
+        long long elapsed = LatencyStats::now() - started;
+
+        unsigned long driven = 0, diffs = 0, differing = 0;
+        for (unsigned long t = 0; t < threads; t++)
+        {
+            driven += results[t].driven;
+            diffs += results[t].diffs;
+            if (results[t].diffs)
+                differing++;
+        }
+        if (diffs)
+            identical = false;
+
+        if (threads == 1)
+            cout << "Pass " << pass+1 << ": " << driven << " ticks, " << diffs << " differ, "
+                 << (results[0].elapsed ? driven*1e9/results[0].elapsed : 0) << " ticks/s on one core" << endl;
+        else
+            cout << "Pass " << pass+1 << ": " << threads << " drivers on as many threads, "
+                 << driven << " ticks, " << diffs << " differ (in " << differing << " drivers), "
+                 << (elapsed ? driven*1e9/elapsed : 0) << " ticks/s" << endl;
+
+        listFiles(dirs, after);
+        for (tfiles::iterator f = after.begin(); f != after.end(); ++f)
+        {
+            tfiles::iterator was = before.find(f->first);
+            if ((was == before.end() || was->second != f->second)
+                && (tracePath == NULL || !sameFile(f->first.c_str(), tracePath)))
+            {
+                cout << "Pass " << pass+1 << " wrote " << f->first << endl;
+                identical = false;
+            }
+        }
+    }
+
+    return identical ? 0 : 2;
+}
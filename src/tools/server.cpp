@@ -0,0 +1,462 @@
+/***************************************************************************
+
+    file                 : server.cpp
+
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/* Stand-in for the SCR server, to test and benchmark clients without TORCS.
+ * It speaks the UDP protocol of the patched TORCS (the ***identified***
+ * handshake, sensors, ***restart*** and ***shutdown***) on one port per car:
+ *
+ *     scr-server port:3001-3004 rate:2000 ticks:10000 record:actions.txt
+ *     FSMDriver3 port:3001-3004
+ *
+ * Options:
+ *     port:<first>[-<last>]  ports to serve, one car each (3001)
+ *     rate:<Hz>              ticks per second, as TORCS does (50 in a race);
+ *                            0 sends the next sensors as soon as the action
+ *                            arrives (0)
+ *     ticks:<n>              ticks of each episode (1000)
+ *     episodes:<n>           episodes, separated by ***restart*** (1)
+ *     replay:<file>          sensor messages to send, one per line, in a
+ *                            loop; without it they are synthesized from a
+ *                            simple model of a car on a straight track
+ *     record:<file>          writes every action received: port, tick,
+ *                            round trip in microseconds and the action
+ *
+ * A client that asks for the binary encoding (wire:binary) gets it. On exit
+ * it reports, per car, the actions received, the ticks left unanswered,
+ * late answers and the round trip times, from sending the sensors to
+ * receiving the action. */
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CarControl.h"
+#include "CarState.h"
+#include "LatencyStats.h"
+
+#define UDP_MSGLEN 2048
+#define LOCKSTEP_TIMEOUT 1000000000LL  // ns without an action before moving on
+
+using namespace std;
+
+static volatile sig_atomic_t stopServer = 0;
+
+static void
+onSignal(int)
+{
+    stopServer = 1;
+}
+
+// One car: its socket, the client driving it and a model of its motion
+struct Car
+{
+    typedef enum{WAITING,RACING,DONE} tstatus;
+
+    int socket;
+    unsigned int port;
+    struct sockaddr_in client;
+    socklen_t clientLen;
+    tstatus status;
+    bool binary;
+
+    unsigned long episode, tick;
+    long long startedAt;        // when the client first identified (ns)
+    long long sentAt;           // when the pending sensors were sent (ns)
+    bool answered;
+    bool restart;               // the client asked for a restart (meta 1)
+
+    // synthetic state: distance (m), speed (km/h, >= 0), position across the
+    // track ([-1,1]), heading relative to the track (rad) and gear
+    float dist, speed, trackPos, angle;
+    int gear;
+
+    LatencyHistogram rtt;
+    unsigned long actions, missed, late;
+
+    Car() : socket(-1), port(0), clientLen(0), status(WAITING), binary(false),
+            episode(0), tick(0), startedAt(0), sentAt(0), answered(true), restart(false),
+            dist(0), speed(0), trackPos(0), angle(0), gear(1),
+            actions(0), missed(0), late(0) {}
+
+    void reset()
+    {
+        tick = 0;
+        sentAt = 0;
+        answered = true;
+        restart = false;
+        dist = speed = trackPos = angle = 0;
+        gear = 1;
+    }
+
+    // Moves the car one simulation step (20 ms) with the given action
+    void apply(const CarControl &cc)
+    {
+        const float dt = 0.02;
+        gear = cc.getGear();
+        float accel = gear != 0 ? cc.getAccel() : 0;
+        speed += (accel*30 - cc.getBrake()*80 - speed*0.01) * dt * 3.6;
+        if (speed < 0)
+            speed = 0;
+        angle += cc.getSteer() * 0.5 * dt;
+        angle *= 0.98;
+        float v = (gear < 0 ? -speed : speed) / 3.6;   // m/s, backwards in reverse
+        trackPos += sin(angle) * v * dt / 5;
+        if (trackPos > 1.5 || trackPos < -1.5)
+            trackPos = trackPos > 0 ? 1.5 : -1.5;
+        dist += v * dt;
+    }
+
+    // The sensors of the synthetic state (range finders at -90..90 degrees,
+    // on a 10 m wide straight)
+    void sense(CarState &cs) const
+    {
+        cs.setAngle(angle);
+        cs.setCurLapTime(tick * 0.02);
+        cs.setDamage(0);
+        cs.setDistFromStart(dist);
+        cs.setDistRaced(dist);
+        cs.setFuel(94);
+        cs.setGear(gear);
+        cs.setLastLapTime(0);
+        for (int i = 0; i < 36; i++)
+            cs.setOpponents(i, 200);
+        cs.setRacePos(1);
+        cs.setRpm(gear > 0 ? 1000 + (int) (speed / gear * 80) % 8000 : 1000);
+        cs.setSpeedX(gear < 0 ? -speed : speed);
+        cs.setSpeedY(0);
+        cs.setSpeedZ(0);
+        for (int i = 0; i < 19; i++)
+        {
+            float a = (-90 + i*10) * M_PI / 180 - angle;
+            float edge = a > 0 ? (1 - trackPos) * 5 : (1 + trackPos) * 5;
+            float s = fabs(sin(a));
+            float range = (edge < 0) ? -1 : (s < 0.025 ? 200 : edge / s);
+            cs.setTrack(i, range > 200 ? 200 : range);
+        }
+        cs.setTrackPos(trackPos);
+        for (int i = 0; i < 4; i++)
+            cs.setWheelSpinVel(i, speed / 1.2);
+        cs.setZ(0.34);
+        for (int i = 0; i < 5; i++)
+            cs.setFocus(i, -1);
+    }
+
+    void print() const
+    {
+        cout << "port " << port << ": " << actions << " actions, " << missed << " missed, "
+             << late << " late";
+        if (rtt.count())
+            cout << ", round trip (us) p50 " << rtt.percentile(0.5)/1e3 << " p99 "
+                 << rtt.percentile(0.99)/1e3 << " p999 " << rtt.percentile(0.999)/1e3
+                 << " max " << rtt.max()/1e3;
+        cout << endl;
+    }
+};
+
+static void
+reply(Car &car, const char *msg, size_t len)
+{
+    sendto(car.socket, msg, len, 0, (struct sockaddr *) &car.client, car.clientLen);
+}
+
+// Sends the next sensors to car, or ends its episode after the last tick
+static void
+step(Car &car, unsigned long ticks, unsigned long episodes, const vector<string> &replay)
+{
+    if (car.sentAt != 0 && !car.answered)
+        car.missed++;
+
+    if (car.tick == ticks || car.restart)
+    {
+        const char *control = (++car.episode == episodes) ? "***shutdown***" : "***restart***";
+        reply(car, control, strlen(control));
+        car.status = car.episode == episodes ? Car::DONE : Car::WAITING;
+        car.reset();
+        return;
+    }
+
+    char msg[UDP_MSGLEN];
+    int len = -1;
+    if (!replay.empty())
+    {
+        const string &line = replay[car.tick % replay.size()];
+        if (car.binary)
+            len = CarState(line.c_str(), line.length()).toBinary(msg, UDP_MSGLEN);
+        else if (line.length() < UDP_MSGLEN)
+        {
+            memcpy(msg, line.c_str(), line.length()+1);
+            len = line.length();
+        }
+    }
+    else
+    {
+        CarState cs;
+        car.sense(cs);
+        len = car.binary ? cs.toBinary(msg, UDP_MSGLEN)
+                         : SimpleParser::stringify(CarState::SCHEMA, &cs, msg, UDP_MSGLEN);
+    }
+    if (len < 0)
+        return;
+
+    car.tick++;
+    car.answered = false;
+    car.sentAt = LatencyStats::now();
+    // text sensors go with their terminating '\0', as TORCS sends them
+    reply(car, msg, car.binary ? len : len+1);
+}
+
+// Handles a datagram from the client of car; returns whether it was an
+// action (so the next sensors can go in lockstep mode)
+static bool
+receive(Car &car, char *buf, int n, const struct sockaddr_in &from, socklen_t fromLen,
+        ofstream &record)
+{
+    long long now = LatencyStats::now();
+    buf[n] = '\0';
+
+    if (strstr(buf, "(init") != NULL)
+    {
+        if (car.status == Car::DONE)
+            return false;
+        car.client = from;
+        car.clientLen = fromLen;
+        car.binary = strstr(buf, BinaryParser::WIRE_GROUP) != NULL;
+        char identified[64];
+        int len = snprintf(identified, sizeof(identified), "***identified***%s",
+                           car.binary ? BinaryParser::WIRE_GROUP : "");
+        reply(car, identified, len);
+        if (car.status == Car::WAITING)
+        {
+            if (car.startedAt == 0)
+                car.startedAt = now;
+            car.status = Car::RACING;
+            car.reset();
+        }
+        return false;
+    }
+    if (car.status != Car::RACING)
+        return false;
+
+    CarControl cc(0, 0, 0, 0, 0, 0, 0);
+    if (BinaryParser::isBinary(buf, n, BinaryParser::BINARY_ACTION))
+        cc.fromBinary(buf, n);
+    else
+        cc.fromString(string(buf, strnlen(buf, n)));
+
+    if (car.answered)
+    {
+        car.late++;
+        return false;
+    }
+    car.answered = true;
+    car.actions++;
+    car.rtt.record(now - car.sentAt);
+    car.apply(cc);
+
+    if (record.is_open())
+    {
+        char action[UDP_MSGLEN];
+        if (cc.toString(action, UDP_MSGLEN) < 0)
+            action[0] = '\0';
+        record << car.port << " " << car.tick << " " << (now - car.sentAt) / 1000 << " "
+               << action << "\n";
+    }
+    // an action asking for a restart ends the episode at once
+    car.restart = (cc.getMeta() == CarControl::META_RESTART);
+    return true;
+}
+
+static bool
+allDone(const vector<Car> &cars)
+{
+    for (size_t c = 0; c < cars.size(); c++)
+        if (cars[c].status != Car::DONE)
+            return false;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int firstPort = 3001, lastPort = 0;
+    double rate = 0;
+    unsigned long ticks = 1000, episodes = 1;
+    vector<string> replay;
+    ofstream record;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "port:", 5) == 0)
+        {
+            if (sscanf(argv[i], "port:%u-%u", &firstPort, &lastPort) < 2)
+                lastPort = firstPort;
+        }
+        else if (strncmp(argv[i], "rate:", 5) == 0)
+            sscanf(argv[i], "rate:%lf", &rate);
+        else if (strncmp(argv[i], "ticks:", 6) == 0)
+            sscanf(argv[i], "ticks:%lu", &ticks);
+        else if (strncmp(argv[i], "episodes:", 9) == 0)
+            sscanf(argv[i], "episodes:%lu", &episodes);
+        else if (strncmp(argv[i], "replay:", 7) == 0)
+        {
+            ifstream in(argv[i]+7);
+            string line;
+            while (getline(in, line))
+                if (!line.empty())
+                    replay.push_back(line);
+            if (replay.empty())
+            {
+                cerr << "no sensor messages in " << argv[i]+7 << endl;
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], "record:", 7) == 0)
+        {
+            record.open(argv[i]+7);
+            if (!record)
+            {
+                cerr << "cannot write " << argv[i]+7 << endl;
+                return 1;
+            }
+        }
+    }
+    if (lastPort < firstPort)
+        lastPort = firstPort;
+    if (ticks == 0 || episodes == 0)
+    {
+        cerr << "ticks and episodes must be positive" << endl;
+        return 1;
+    }
+
+    const unsigned int numCars = lastPort - firstPort + 1;
+    vector<Car> cars(numCars);
+    vector<struct pollfd> fds(numCars);
+    for (unsigned int c = 0; c < numCars; c++)
+    {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(firstPort + c);
+
+        cars[c].port = firstPort + c;
+        cars[c].socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (cars[c].socket < 0
+            || bind(cars[c].socket, (struct sockaddr *) &address, sizeof(address)) < 0)
+        {
+            cerr << "cannot listen on port " << firstPort + c << endl;
+            return 1;
+        }
+        fds[c].fd = cars[c].socket;
+        fds[c].events = POLLIN;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    cout << "Serving " << numCars << " car(s) on ports " << firstPort << "-" << lastPort << ", ";
+    if (rate > 0)
+        cout << rate << " ticks/s, ";
+    else
+        cout << "lockstep, ";
+    cout << ticks << " ticks x " << episodes << " episode(s), "
+         << (replay.empty() ? "synthetic sensors" : "replayed sensors") << endl;
+
+    const long long period = rate > 0 ? (long long) (1e9 / rate) : 0;
+    long long start = LatencyStats::now(), nextTick = start + period;
+    unsigned long scheduled = 0;
+    char buf[UDP_MSGLEN];
+
+    while (!stopServer && !allDone(cars))
+    {
+        long long now = LatencyStats::now();
+
+        if (period > 0 && now >= nextTick)
+        {
+            // one simulation step for every car, on a fixed schedule
+            for (unsigned int c = 0; c < numCars; c++)
+                if (cars[c].status == Car::RACING)
+                    step(cars[c], ticks, episodes, replay);
+            nextTick = start + (++scheduled + 1) * period;
+            // a server that falls behind skips ticks instead of bursting
+            if (nextTick < now)
+            {
+                scheduled = (now - start) / period;
+                nextTick = start + (scheduled + 1) * period;
+            }
+        }
+        else if (period == 0)
+        {
+            // lockstep: a car that does not answer is moved on anyway
+            for (unsigned int c = 0; c < numCars; c++)
+                if (cars[c].status == Car::RACING
+                    && (cars[c].sentAt == 0 || (!cars[c].answered && now - cars[c].sentAt > LOCKSTEP_TIMEOUT)))
+                    step(cars[c], ticks, episodes, replay);
+        }
+
+        long long wait = period > 0 ? nextTick - LatencyStats::now() : 100000000LL;
+        struct timespec timeout;
+        timeout.tv_sec = wait > 0 ? wait / 1000000000LL : 0;
+        timeout.tv_nsec = wait > 0 ? wait % 1000000000LL : 0;
+        if (ppoll(&fds[0], numCars, &timeout, NULL) <= 0)
+            continue;
+
+        for (unsigned int c = 0; c < numCars; c++)
+        {
+            if (!(fds[c].revents & POLLIN))
+                continue;
+            Car &car = cars[c];
+            struct sockaddr_in from;
+            socklen_t fromLen = sizeof(from);
+            int n;
+            while ((n = recvfrom(car.socket, buf, UDP_MSGLEN-1, MSG_DONTWAIT,
+                                 (struct sockaddr *) &from, &fromLen)) > 0)
+            {
+                if (receive(car, buf, n, from, fromLen, record) && (period == 0 || car.restart))
+                    step(car, ticks, episodes, replay);
+                fromLen = sizeof(from);
+            }
+        }
+    }
+
+    // throughput since the first client identified
+    long long end = LatencyStats::now(), first = end;
+    unsigned long actions = 0;
+    LatencyHistogram rtt;
+    for (unsigned int c = 0; c < numCars; c++)
+    {
+        if (cars[c].startedAt != 0 && cars[c].startedAt < first)
+            first = cars[c].startedAt;
+        cars[c].print();
+        actions += cars[c].actions;
+        rtt.add(cars[c].rtt);
+        close(cars[c].socket);
+    }
+    double seconds = (end - first) / 1e9;
+    cout << "all: " << actions << " actions in " << seconds << " s (" << actions / seconds
+         << " per second), round trip (us) p50 " << rtt.percentile(0.5)/1e3 << " p99 "
+         << rtt.percentile(0.99)/1e3 << " p999 " << rtt.percentile(0.999)/1e3 << endl;
+    return 0;
+}